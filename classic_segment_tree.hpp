@@ -6,13 +6,85 @@
 #ifndef CLASSIC_SEGMENT_TREE_HPP
 #define CLASSIC_SEGMENT_TREE_HPP
 
-#include <optional>
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "functional.hpp"
 
+/**
+ * Explicit stack shared by the traversals below in place of recursion. A
+ * frame per level and a pending sibling per level bound its size by the
+ * depth of the tree, at most the bit width of SizeType. Range queries follow
+ * the left child and defer the right one only where the range splits.
+ */
+template <std::integral SizeType = size_t> struct segment_tree_stack {
+	static constexpr size_t max_depth = 8 * sizeof(SizeType);
+	struct frame {
+		size_t u;
+		SizeType lo, hi;
+		bool expanded;
+	};
+	using type = std::array<frame, 2 * max_depth + 1>;
+};
+
+/**
+ * Node indices of the 2n memory layout shared by the array based trees below,
+ * the left subtree is stored right after its parent and the right subtree
+ * after the whole left subtree.
+ * https://cp-algorithms.com/data_structures/segment_tree.html#memory-efficient-implementation
+ */
+struct segment_tree_2n_layout {
+	static constexpr size_t get_root_index() { return 0; }
+	static constexpr size_t get_left_index(size_t p, size_t, size_t) {
+		return p + 1;
+	}
+	static constexpr size_t get_right_index(size_t p, size_t lo, size_t hi) {
+		return p + ((hi - lo) / 2 + 1) * 2;
+	}
+};
+
+/**
+ * Node pool of the pointer-based trees below, one contiguous vector of Node
+ * addressed by 32-bit ids so that child links stay small. Released ids are
+ * handed out again by the next create.
+ */
+template <class Node> class node_arena {
+	std::vector<Node> nodes;
+	std::vector<uint32_t> free_nodes;
+
+  public:
+	Node &operator[](uint32_t u) { return nodes[u]; }
+	const Node &operator[](uint32_t u) const { return nodes[u]; }
+
+	uint32_t create(const Node &node) {
+		if (!free_nodes.empty()) {
+			uint32_t u = free_nodes.back();
+			free_nodes.pop_back();
+			nodes[u] = node;
+			return u;
+		}
+		nodes.push_back(node);
+		return nodes.size() - 1;
+	}
+	void release(uint32_t u) { free_nodes.push_back(u); }
+
+	void reserve(size_t capacity) { nodes.reserve(capacity); }
+	void clear() {
+		nodes.clear();
+		free_nodes.clear();
+	}
+};
+
 template <class T, class U = T, class CombineOp = std::plus<>,
           class UpdateOp = std::plus<>>
-class classic_segment_tree {
+class classic_segment_tree : segment_tree_2n_layout {
 	size_t n;
 	std::vector<T> tree;
 	CombineOp combinator;
@@ -22,77 +94,29 @@ class classic_segment_tree {
 	static constexpr size_t npos = -1;
 
   private:
-	// 2n memory implementation
-	// https://cp-algorithms.com/data_structures/segment_tree.html#memory-efficient-implementation
-	constexpr size_t get_root_index() const { return 0; }
-	constexpr size_t get_left_index(size_t p, size_t lo, size_t hi) const {
-		return p + 1;
-	}
-	constexpr size_t get_right_index(size_t p, size_t lo, size_t hi) const {
-		return p + ((hi - lo) / 2 + 1) * 2;
-	}
-
-	void build(const std::vector<T> &init, size_t p, size_t lo, size_t hi) {
-		if (lo == hi) {
-			tree[p] = init[lo];
-		} else {
-			size_t mi = lo + (hi - lo) / 2;
-			auto ul = get_left_index(p, lo, hi),
-			     ur = get_right_index(p, lo, hi);
-			build(init, ul, lo, mi);
-			build(init, ur, mi + 1, hi);
-			tree[p] = combinator(tree[ul], tree[ur]);
-		}
-	}
+	using stack = segment_tree_stack<>::type;
 
-	void modify(size_t p, const U &val, size_t u, size_t lo, size_t hi) {
-		if (lo == hi) {
-			tree[u] = updater(tree[u], val);
-		} else {
+	void build(const std::vector<T> &init) {
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			if (lo == hi) {
+				tree[u] = init[lo];
+				continue;
+			}
 			size_t mi = lo + (hi - lo) / 2;
 			auto ul = get_left_index(u, lo, hi),
 			     ur = get_right_index(u, lo, hi);
-			if (p <= mi) {
-				modify(p, val, ul, lo, mi);
+			if (expanded) {
+				tree[u] = combinator(tree[ul], tree[ur]);
 			} else {
-				modify(p, val, ur, mi + 1, hi);
-			}
-			tree[u] = combinator(tree[ul], tree[ur]);
-		}
-	}
-
-	T query(size_t l, size_t r, size_t u, size_t lo, size_t hi) const {
-		if (l == lo && r == hi) {
-			return tree[u];
-		}
-		size_t mi = lo + (hi - lo) / 2;
-		if (r <= mi) {
-			return query(l, r, get_left_index(u, lo, hi), lo, mi);
-		}
-		if (l > mi) {
-			return query(l, r, get_right_index(u, lo, hi), mi + 1, hi);
-		}
-		auto ul = get_left_index(u, lo, hi), ur = get_right_index(u, lo, hi);
-		return combinator(query(l, mi, ul, lo, mi),
-		                  query(mi + 1, r, ur, mi + 1, hi));
-	}
-
-	template <class Pred>
-	size_t find(size_t l, size_t u, size_t lo, size_t hi, Pred &pred) const {
-		if (!pred(tree[u])) {
-			return npos;
-		}
-		if (lo == hi) {
-			return lo;
-		}
-		size_t mi = lo + (hi - lo) / 2;
-		if (l <= mi) {
-			if (size_t l_res = find(l, get_left_index(u, lo, hi), lo, mi, pred);
-			    l_res != npos) {
-				return l_res;
+				stk[top++] = {u, lo, hi, true};
+				stk[top++] = {ur, mi + 1, hi, false};
+				stk[top++] = {ul, lo, mi, false};
 			}
 		}
-		return find(l, get_right_index(u, lo, hi), mi + 1, hi, pred);
 	}
 
   public:
@@ -101,7 +125,7 @@ class classic_segment_tree {
 	                              UpdateOp updater = {})
 	    : n(init.size()), tree(n + n), combinator(combinator),
 	      updater(updater) {
-		build(init, get_root_index(), 0, n - 1);
+		build(init);
 	}
 	explicit classic_segment_tree(int n, const T &init = {},
 	                              CombineOp combinator = {},
@@ -111,17 +135,71 @@ class classic_segment_tree {
 	size_t size() const { return n; }
 
 	void modify(size_t p, const U &val) {
-		modify(p, val, get_root_index(), 0, n - 1);
+		// parents are recombined from the saved child indices on the way up
+		std::array<std::array<size_t, 3>, segment_tree_stack<>::max_depth> path;
+		size_t depth = 0, u = get_root_index(), lo = 0, hi = n - 1;
+		while (lo != hi) {
+			size_t mi = lo + (hi - lo) / 2;
+			auto ul = get_left_index(u, lo, hi),
+			     ur = get_right_index(u, lo, hi);
+			path[depth++] = {u, ul, ur};
+			if (p <= mi) {
+				u = ul, hi = mi;
+			} else {
+				u = ur, lo = mi + 1;
+			}
+		}
+		tree[u] = updater(tree[u], val);
+		while (depth) {
+			auto [v, ul, ur] = path[--depth];
+			tree[v] = combinator(tree[ul], tree[ur]);
+		}
 	}
 
 	T query(size_t l, size_t r) const {
-		return query(l, r, get_root_index(), 0, n - 1);
+		fn::fold_result<CombineOp, T> res;
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			while (l > lo || hi > r) {
+				size_t mi = lo + (hi - lo) / 2;
+				if (mi < l) {
+					u = get_right_index(u, lo, hi), lo = mi + 1;
+					continue;
+				}
+				if (mi < r)
+					stk[top++] = {get_right_index(u, lo, hi), mi + 1, hi,
+					              false};
+				u = get_left_index(u, lo, hi), hi = mi;
+			}
+			res.add(tree[u], combinator);
+		}
+		return res.value();
 	}
 
 	template <std::predicate<const T &> Pred>
 	size_t find(size_t l, size_t r, Pred pred = {}) const {
-		size_t result = find(l, get_root_index(), 0, n - 1, pred);
-		return result <= r ? result : npos;
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			while (pred(tree[u])) {
+				if (lo == hi)
+					return lo <= r ? lo : npos;
+				size_t mi = lo + (hi - lo) / 2;
+				auto ur = get_right_index(u, lo, hi);
+				if (mi < l) {
+					u = ur, lo = mi + 1;
+				} else {
+					stk[top++] = {ur, mi + 1, hi, false};
+					u = get_left_index(u, lo, hi), hi = mi;
+				}
+			}
+		}
+		return npos;
 	}
 
 	template <class R, std::predicate<const R &, const T &> BinaryPred =
@@ -134,10 +212,12 @@ class classic_segment_tree {
 template <class T, class U = T, class CombineOp = std::plus<>,
           class UpdateOp = std::plus<>, class CombineUpdateOp = UpdateOp,
           class UpdateLenOp = fn::noop>
-class classic_lazy_segment_tree {
+class classic_lazy_segment_tree : segment_tree_2n_layout {
+	using tag = fn::lazy_tag<T, U, UpdateOp, CombineUpdateOp, UpdateLenOp>;
+
 	size_t n;
 	std::vector<T> tree;
-	std::vector<std::optional<U>> lazy;
+	std::vector<typename tag::type> lazy;
 	CombineOp combinator;
 	UpdateOp updater;
 	CombineUpdateOp lazyCombinator;
@@ -147,96 +227,94 @@ class classic_lazy_segment_tree {
 	static constexpr size_t npos = -1;
 
   private:
-	// 2n memory implementation
-	// https://cp-algorithms.com/data_structures/segment_tree.html#memory-efficient-implementation
-	constexpr size_t get_root_index() const { return 0; }
-	constexpr size_t get_left_index(size_t p, size_t lo, size_t hi) const {
-		return p + 1;
-	}
-	constexpr size_t get_right_index(size_t p, size_t lo, size_t hi) const {
-		return p + ((hi - lo) / 2 + 1) * 2;
-	}
+	using stack = segment_tree_stack<>::type;
 
-	void build(const std::vector<T> &init, size_t p, size_t lo, size_t hi) {
-		if (lo == hi) {
-			tree[p] = init[lo];
-		} else {
+	void build(const std::vector<T> &init) {
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			if (lo == hi) {
+				tree[u] = init[lo];
+				continue;
+			}
 			size_t mi = lo + (hi - lo) / 2;
-			auto ul = get_left_index(p, lo, hi),
-			     ur = get_right_index(p, lo, hi);
-			build(init, ul, lo, mi);
-			build(init, ur, mi + 1, hi);
-			tree[p] = combinator(tree[ul], tree[ur]);
+			auto ul = get_left_index(u, lo, hi),
+			     ur = get_right_index(u, lo, hi);
+			if (expanded) {
+				tree[u] = combinator(tree[ul], tree[ur]);
+			} else {
+				stk[top++] = {u, lo, hi, true};
+				stk[top++] = {ur, mi + 1, hi, false};
+				stk[top++] = {ul, lo, mi, false};
+			}
 		}
 	}
 
 	void apply(size_t p, const U &val, size_t lo, size_t hi) {
 		tree[p] = updater(tree[p], updaterLen(val, hi - lo + 1));
-		lazy[p] = lazy[p].has_value() ? lazyCombinator(*lazy[p], val) : val;
+		tag::compose(lazy[p], val, lazyCombinator);
 	}
 
 	void push(size_t p, size_t lo, size_t hi) {
-		if (lazy[p]) {
-			auto mi = lo + (hi - lo) / 2;
-			auto ul = get_left_index(p, lo, hi),
-			     ur = get_right_index(p, lo, hi);
-			apply(ul, *lazy[p], lo, mi);
-			apply(ur, *lazy[p], mi + 1, hi);
-			lazy[p].reset();
-		}
-	}
-
-	void modify(size_t l, size_t r, const U &val, size_t u, size_t lo,
-	            size_t hi) {
-		if (l <= lo && hi <= r) {
-			apply(u, val, lo, hi);
+		auto val = tag::get(lazy[p]);
+		if (!val)
 			return;
-		}
-		push(u, lo, hi);
-		size_t mi = lo + (hi - lo) / 2;
-		auto ul = get_left_index(u, lo, hi), ur = get_right_index(u, lo, hi);
-		if (l <= mi) {
-			modify(l, r, val, ul, lo, mi);
-		}
-		if (mi < r) {
-			modify(l, r, val, ur, mi + 1, hi);
-		}
-		tree[u] = combinator(tree[ul], tree[ur]);
+		auto mi = lo + (hi - lo) / 2;
+		auto ul = get_left_index(p, lo, hi), ur = get_right_index(p, lo, hi);
+		apply(ul, *val, lo, mi);
+		apply(ur, *val, mi + 1, hi);
+		lazy[p] = tag::empty();
 	}
 
-	T query(size_t l, size_t r, size_t u, size_t lo, size_t hi) {
-		if (l <= lo && hi <= r) {
-			return tree[u];
-		}
-		push(u, lo, hi);
-		size_t mi = lo + (hi - lo) / 2;
-		auto ul = get_left_index(u, lo, hi), ur = get_right_index(u, lo, hi);
-		if (r <= mi) {
-			return query(l, r, ul, lo, mi);
-		}
-		if (mi < l) {
-			return query(l, r, ur, mi + 1, hi);
+	void modify_range(size_t l, size_t r, const U &val) {
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			if (expanded) {
+				tree[u] = combinator(tree[get_left_index(u, lo, hi)],
+				                     tree[get_right_index(u, lo, hi)]);
+				continue;
+			}
+			if (l <= lo && hi <= r) {
+				apply(u, val, lo, hi);
+				continue;
+			}
+			push(u, lo, hi);
+			size_t mi = lo + (hi - lo) / 2;
+			stk[top++] = {u, lo, hi, true};
+			if (mi < r)
+				stk[top++] = {get_right_index(u, lo, hi), mi + 1, hi, false};
+			if (l <= mi)
+				stk[top++] = {get_left_index(u, lo, hi), lo, mi, false};
 		}
-		return combinator(query(l, r, ul, lo, mi), query(l, r, ur, mi + 1, hi));
 	}
 
-	template <class Pred>
-	size_t find(size_t l, size_t u, size_t lo, size_t hi, Pred &pred) {
-		if (!pred(tree[u])) {
-			return npos;
-		}
-		if (lo == hi) {
-			return lo;
-		}
-		push(u, lo, hi);
-		size_t mi = lo + (hi - lo) / 2;
-		if (l <= mi) {
-			if (size_t l_res = find(l, get_left_index(u, lo, hi), lo, mi, pred);
-			    l_res != npos) {
-				return l_res;
+	T query_range(size_t l, size_t r) {
+		fn::fold_result<CombineOp, T> res;
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			while (l > lo || hi > r) {
+				push(u, lo, hi);
+				size_t mi = lo + (hi - lo) / 2;
+				if (mi < l) {
+					u = get_right_index(u, lo, hi), lo = mi + 1;
+					continue;
+				}
+				if (mi < r)
+					stk[top++] = {get_right_index(u, lo, hi), mi + 1, hi,
+					              false};
+				u = get_left_index(u, lo, hi), hi = mi;
 			}
+			res.add(tree[u], combinator);
 		}
-		return find(l, get_right_index(u, lo, hi), mi + 1, hi, pred);
+		return res.value();
 	}
 
   public:
@@ -245,10 +323,10 @@ class classic_lazy_segment_tree {
 	                                   UpdateOp updater = {},
 	                                   CombineUpdateOp lazyCombinator = {},
 	                                   UpdateLenOp updaterLen = {})
-	    : n(init.size()), tree(n + n), lazy(n + n), combinator(combinator),
-	      updater(updater), lazyCombinator(lazyCombinator),
-	      updaterLen(updaterLen) {
-		build(init, get_root_index(), 0, n - 1);
+	    : n(init.size()), tree(n + n), lazy(n + n, tag::empty()),
+	      combinator(combinator), updater(updater),
+	      lazyCombinator(lazyCombinator), updaterLen(updaterLen) {
+		build(init);
 	}
 	explicit classic_lazy_segment_tree(size_t n, const T &init = {},
 	                                   CombineOp combinator = {},
@@ -259,15 +337,33 @@ class classic_lazy_segment_tree {
 	                                updater, lazyCombinator, updaterLen) {}
 
 	void modify(int l, int r, const U &val) {
-		modify(l, r, val, get_root_index(), 0, n - 1);
+		modify_range(size_t(l), size_t(r), val);
 	}
 
-	T query(int l, int r) { return query(l, r, get_root_index(), 0, n - 1); }
+	T query(int l, int r) { return query_range(size_t(l), size_t(r)); }
 
 	template <std::predicate<const T &> Pred>
 	size_t find(size_t l, size_t r, Pred pred = {}) {
-		size_t result = find(l, get_root_index(), 0, n - 1, pred);
-		return result <= r ? result : npos;
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			while (pred(tree[u])) {
+				if (lo == hi)
+					return lo <= r ? lo : npos;
+				push(u, lo, hi);
+				size_t mi = lo + (hi - lo) / 2;
+				auto ur = get_right_index(u, lo, hi);
+				if (mi < l) {
+					u = ur, lo = mi + 1;
+				} else {
+					stk[top++] = {ur, mi + 1, hi, false};
+					u = get_left_index(u, lo, hi), hi = mi;
+				}
+			}
+		}
+		return npos;
 	}
 
 	template <class R, std::predicate<const R &, const T &> BinaryPred =
@@ -277,140 +373,757 @@ class classic_lazy_segment_tree {
 	}
 };
 
+/**
+ * Segment tree beats (Ji driver) over the classic 2n layout. Each node keeps
+ * the two largest and two smallest distinct values with the multiplicity of
+ * the extremes, so range chmin/chmax can be applied as a tag whenever they
+ * only touch the extreme values. All updates run in amortized O(log^2 n).
+ */
+template <class T> class segment_tree_beats : segment_tree_2n_layout {
+	struct node {
+		T max1, max2, min1, min2, sum, add;
+		size_t max_cnt, min_cnt;
+	};
+
+	static constexpr T lowest = std::numeric_limits<T>::lowest();
+	static constexpr T highest = std::numeric_limits<T>::max();
+
+	size_t n;
+	std::vector<node> tree;
+
+	using stack = segment_tree_stack<>::type;
+
+	// len copies of val, such nodes carry no add tag as their children
+	// are overwritten on push
+	static node make_uniform(const T &val, size_t len = 1) {
+		return {val, lowest, val, highest, val * T(len), T{}, len, len};
+	}
+
+	// clamp(x + val, lo, hi) without overflowing when x + val does not fit
+	static T clamp_add(const T &x, const T &val, const T &lo, const T &hi) {
+		if (val >= T{}) {
+			if (hi < lowest + val || x > hi - val)
+				return hi;
+			return std::max(x + val, lo);
+		}
+		if (lo > highest + val || x < lo - val)
+			return lo;
+		return std::min(x + val, hi);
+	}
+
+	static node merge(const node &a, const node &b) {
+		node res{};
+		if (a.max1 == b.max1) {
+			res.max1 = a.max1, res.max_cnt = a.max_cnt + b.max_cnt;
+			res.max2 = std::max(a.max2, b.max2);
+		} else if (a.max1 > b.max1) {
+			res.max1 = a.max1, res.max_cnt = a.max_cnt;
+			res.max2 = std::max(a.max2, b.max1);
+		} else {
+			res.max1 = b.max1, res.max_cnt = b.max_cnt;
+			res.max2 = std::max(a.max1, b.max2);
+		}
+		if (a.min1 == b.min1) {
+			res.min1 = a.min1, res.min_cnt = a.min_cnt + b.min_cnt;
+			res.min2 = std::min(a.min2, b.min2);
+		} else if (a.min1 < b.min1) {
+			res.min1 = a.min1, res.min_cnt = a.min_cnt;
+			res.min2 = std::min(a.min2, b.min1);
+		} else {
+			res.min1 = b.min1, res.min_cnt = b.min_cnt;
+			res.min2 = std::min(a.min1, b.min2);
+		}
+		res.sum = a.sum + b.sum;
+		return res;
+	}
+
+	void pull(size_t u, size_t lo, size_t hi) {
+		T add = tree[u].add;
+		tree[u] = merge(tree[get_left_index(u, lo, hi)],
+		                tree[get_right_index(u, lo, hi)]);
+		tree[u].add = add;
+	}
+
+	void apply_add(size_t u, const T &val, size_t len) {
+		node &x = tree[u];
+		x.max1 += val, x.min1 += val;
+		if (x.max2 != lowest)
+			x.max2 += val;
+		if (x.min2 != highest)
+			x.min2 += val;
+		x.sum += val * T(len);
+		if (x.max1 != x.min1)
+			x.add += val;
+	}
+
+	// lowers the maximum, only valid while val > max2
+	void apply_chmin(size_t u, const T &val) {
+		node &x = tree[u];
+		if (x.max1 <= val)
+			return;
+		// subtract first, val - max1 overflows for val near lowest
+		x.sum = x.sum - x.max1 * T(x.max_cnt) + val * T(x.max_cnt);
+		if (x.min1 == x.max1)
+			x.min1 = val;
+		else if (x.min2 == x.max1)
+			x.min2 = val;
+		x.max1 = val;
+	}
+
+	// raises the minimum, only valid while val < min2
+	void apply_chmax(size_t u, const T &val) {
+		node &x = tree[u];
+		if (x.min1 >= val)
+			return;
+		x.sum = x.sum - x.min1 * T(x.min_cnt) + val * T(x.min_cnt);
+		if (x.max1 == x.min1)
+			x.max1 = val;
+		else if (x.max2 == x.min1)
+			x.max2 = val;
+		x.min1 = val;
+	}
+
+	// moves the tags of a parent with values in [lo, hi] down to u, which
+	// takes every value x of u to clamp(x + val, lo, hi), computing the
+	// extremes directly so stale values far outside [lo, hi] cannot overflow
+	void push_to(size_t u, const T &val, const T &lo, const T &hi,
+	             size_t len) {
+		node &x = tree[u];
+		T max1 = clamp_add(x.max1, val, lo, hi),
+		  min1 = clamp_add(x.min1, val, lo, hi);
+		if (max1 == min1) {
+			x = make_uniform(max1, len);
+			return;
+		}
+		size_t rest = len - x.max_cnt - x.min_cnt;
+		x.sum = x.sum - x.max1 * T(x.max_cnt) - x.min1 * T(x.min_cnt) +
+		        val * T(rest) + max1 * T(x.max_cnt) + min1 * T(x.min_cnt);
+		if (x.max2 != lowest)
+			x.max2 = clamp_add(x.max2, val, lo, hi);
+		if (x.min2 != highest)
+			x.min2 = clamp_add(x.min2, val, lo, hi);
+		x.max1 = max1, x.min1 = min1;
+		x.add += val;
+	}
+
+	void push(size_t u, size_t lo, size_t hi) {
+		size_t mi = lo + (hi - lo) / 2;
+		auto ul = get_left_index(u, lo, hi), ur = get_right_index(u, lo, hi);
+		const node &x = tree[u];
+		if (x.max1 == x.min1) {
+			tree[ul] = make_uniform(x.max1, mi - lo + 1);
+			tree[ur] = make_uniform(x.max1, hi - mi);
+			return;
+		}
+		push_to(ul, x.add, x.min1, x.max1, mi - lo + 1);
+		push_to(ur, x.add, x.min1, x.max1, hi - mi);
+		tree[u].add = T{};
+	}
+
+	void build(const std::vector<T> &init) {
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			if (lo == hi) {
+				tree[u] = make_uniform(init[lo]);
+				continue;
+			}
+			size_t mi = lo + (hi - lo) / 2;
+			if (expanded) {
+				pull(u, lo, hi);
+			} else {
+				stk[top++] = {u, lo, hi, true};
+				stk[top++] = {get_right_index(u, lo, hi), mi + 1, hi, false};
+				stk[top++] = {get_left_index(u, lo, hi), lo, mi, false};
+			}
+		}
+	}
+
+	// visits [l, r] skipping subtrees where skip holds and tagging the
+	// covered ones where tag holds, then recombines the visited parents,
+	// covered leaves are always tagged as they have no children to push to
+	template <class Skip, class Tag, class Apply>
+	void update(size_t l, size_t r, Skip skip, Tag tag, Apply apply) {
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			if (expanded) {
+				pull(u, lo, hi);
+				continue;
+			}
+			if (r < lo || hi < l || skip(tree[u]))
+				continue;
+			if (l <= lo && hi <= r && (lo == hi || tag(tree[u]))) {
+				apply(u, hi - lo + 1);
+				continue;
+			}
+			push(u, lo, hi);
+			size_t mi = lo + (hi - lo) / 2;
+			stk[top++] = {u, lo, hi, true};
+			stk[top++] = {get_right_index(u, lo, hi), mi + 1, hi, false};
+			stk[top++] = {get_left_index(u, lo, hi), lo, mi, false};
+		}
+	}
+
+	template <class Get, class Op>
+	T query(size_t l, size_t r, T res, Get get, Op op) {
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			while (l > lo || hi > r) {
+				push(u, lo, hi);
+				size_t mi = lo + (hi - lo) / 2;
+				if (mi < l) {
+					u = get_right_index(u, lo, hi), lo = mi + 1;
+					continue;
+				}
+				if (mi < r)
+					stk[top++] = {get_right_index(u, lo, hi), mi + 1, hi,
+					              false};
+				u = get_left_index(u, lo, hi), hi = mi;
+			}
+			res = op(res, get(tree[u]));
+		}
+		return res;
+	}
+
+  public:
+	explicit segment_tree_beats(const std::vector<T> &init)
+	    : n(init.size()), tree(n + n) {
+		build(init);
+	}
+	explicit segment_tree_beats(size_t n, const T &init = {})
+	    : segment_tree_beats(std::vector<T>(n, init)) {}
+
+	size_t size() const { return n; }
+
+	// a[i] = min(a[i], val) for i in [l, r]
+	void chmin(size_t l, size_t r, const T &val) {
+		update(
+		    l, r, [&](const node &x) { return x.max1 <= val; },
+		    [&](const node &x) { return x.max2 < val; },
+		    [&](size_t u, size_t) { apply_chmin(u, val); });
+	}
+
+	// a[i] = max(a[i], val) for i in [l, r]
+	void chmax(size_t l, size_t r, const T &val) {
+		update(
+		    l, r, [&](const node &x) { return x.min1 >= val; },
+		    [&](const node &x) { return x.min2 > val; },
+		    [&](size_t u, size_t) { apply_chmax(u, val); });
+	}
+
+	// a[i] += val for i in [l, r]
+	void add(size_t l, size_t r, const T &val) {
+		update(
+		    l, r, [](const node &) { return false; },
+		    [](const node &) { return true; },
+		    [&](size_t u, size_t len) { apply_add(u, val, len); });
+	}
+
+	T query_sum(size_t l, size_t r) {
+		return query(
+		    l, r, T{}, [](const node &x) { return x.sum; }, std::plus<>{});
+	}
+
+	T query_min(size_t l, size_t r) {
+		return query(
+		    l, r, highest, [](const node &x) { return x.min1; },
+		    [](const T &a, const T &b) { return std::min(a, b); });
+	}
+
+	T query_max(size_t l, size_t r) {
+		return query(
+		    l, r, lowest, [](const node &x) { return x.max1; },
+		    [](const T &a, const T &b) { return std::max(a, b); });
+	}
+};
+
+/**
+ * Default initializer of dynamic_segment_tree, either a constant or any
+ * callable on the range [lo, hi] of a new node. Callables are type erased,
+ * pass decltype(callable) as Initializer to avoid the indirect call.
+ */
+template <class T, class SizeType> class dynamic_initializer {
+	fn::constant<T> constant;
+	std::function<T(SizeType, SizeType)> function;
+
+  public:
+	dynamic_initializer(const T &value = {}) : constant{value} {}
+	template <std::invocable<SizeType, SizeType> F>
+	    requires(!std::convertible_to<F, T> &&
+	             !std::same_as<F, dynamic_initializer>)
+	dynamic_initializer(F f) : constant{T{}}, function(std::move(f)) {}
+
+	T operator()(SizeType lo, SizeType hi) const {
+		return function ? function(lo, hi) : constant(lo, hi);
+	}
+};
+
 template <class T, class U = T, class CombineOp = std::plus<>,
           class UpdateOp = std::plus<>, class CombineUpdateOp = UpdateOp,
-          class UpdateLenOp = fn::noop, std::integral SizeType = size_t>
+          class UpdateLenOp = fn::noop, std::integral SizeType = size_t,
+          class Initializer = dynamic_initializer<T, SizeType>>
 class dynamic_segment_tree {
+	using tag = fn::lazy_tag<T, U, UpdateOp, CombineUpdateOp, UpdateLenOp>;
+
+	// all fields of a node live together in one arena, 0 marks a missing
+	// child since the root is always the first node
+	struct node {
+		T value;
+		typename tag::type lazy;
+		uint32_t left_child, right_child;
+	};
+
 	SizeType n;
-	std::vector<T> tree;
-	std::vector<std::optional<U>> lazy;
-	std::vector<size_t> left_child, right_child;
-	std::function<T(SizeType, SizeType)> initializer;
+	node_arena<node> nodes;
+	Initializer initializer;
 	CombineOp combinator;
 	UpdateOp updater;
 	CombineUpdateOp lazyCombinator;
 	UpdateLenOp updaterLen;
-	size_t root;
 
-	// 2n memory implementation
-	// https://cp-algorithms.com/data_structures/segment_tree.html#memory-efficient-implementation
-	size_t get_root_index() const { return root; }
+	size_t get_root_index() const { return 0; }
 	size_t get_left_index(size_t p, SizeType lo, SizeType hi) {
-		if (!left_child[p])
-			left_child[p] = create_node(lo, lo + (hi - lo) / 2);
-		return left_child[p];
+		if (!nodes[p].left_child) {
+			auto u = create_node(lo, lo + (hi - lo) / 2);
+			nodes[p].left_child = u;
+		}
+		return nodes[p].left_child;
 	}
 	size_t get_right_index(size_t p, SizeType lo, SizeType hi) {
-		if (!right_child[p])
-			right_child[p] = create_node(lo + (hi - lo) / 2 + 1, hi);
-		return right_child[p];
+		if (!nodes[p].right_child) {
+			auto u = create_node(lo + (hi - lo) / 2 + 1, hi);
+			nodes[p].right_child = u;
+		}
+		return nodes[p].right_child;
 	}
 
-	size_t create_node(SizeType lo, SizeType hi) {
-		tree.push_back(initializer(lo, hi));
-		lazy.push_back(std::nullopt);
-		left_child.push_back(0);
-		right_child.push_back(0);
-		return tree.size() - 1;
+	uint32_t create_node(SizeType lo, SizeType hi) {
+		return nodes.create({initializer(lo, hi), tag::empty(), 0, 0});
 	}
 
-	void build(const std::vector<T> &init, size_t p, size_t lo, size_t hi) {
-		if (lo == hi) {
-			tree[p] = init[lo];
-		} else {
-			size_t mi = lo + (hi - lo) / 2;
-			auto ul = get_left_index(p, lo, hi),
-			     ur = get_right_index(p, lo, hi);
-			build(init, ul, lo, mi);
-			build(init, ur, mi + 1, hi);
-			tree[p] = combinator(tree[ul], tree[ur]);
+	using stack = typename segment_tree_stack<SizeType>::type;
+
+	void build(const std::vector<T> &init) {
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			if (lo == hi) {
+				nodes[u].value = init[lo];
+				continue;
+			}
+			SizeType mi = lo + (hi - lo) / 2;
+			auto ul = get_left_index(u, lo, hi),
+			     ur = get_right_index(u, lo, hi);
+			if (expanded) {
+				nodes[u].value = combinator(nodes[ul].value, nodes[ur].value);
+			} else {
+				stk[top++] = {u, lo, hi, true};
+				stk[top++] = {ur, mi + 1, hi, false};
+				stk[top++] = {ul, lo, mi, false};
+			}
 		}
 	}
 
 	void apply(size_t p, const U &val, SizeType lo, SizeType hi) {
-		tree[p] = updater(tree[p], updaterLen(val, hi - lo + 1));
-		lazy[p] = lazy[p].has_value() ? lazyCombinator(*lazy[p], val) : val;
+		node &u = nodes[p];
+		u.value = updater(u.value, updaterLen(val, hi - lo + 1));
+		tag::compose(u.lazy, val, lazyCombinator);
 	}
 
 	void push(size_t p, SizeType lo, SizeType hi) {
-		if (lazy[p]) {
-			auto mi = lo + (hi - lo) / 2;
-			auto ul = get_left_index(p, lo, hi),
-			     ur = get_right_index(p, lo, hi);
-			apply(ul, *lazy[p], lo, mi);
-			apply(ur, *lazy[p], mi + 1, hi);
-			lazy[p].reset();
-		}
-	}
-
-	void modify(SizeType l, SizeType r, const U &val, size_t u, SizeType lo,
-	            SizeType hi) {
-		if (l <= lo && hi <= r) {
-			apply(u, val, lo, hi);
+		if (!tag::get(nodes[p].lazy))
 			return;
-		}
-		push(u, lo, hi);
-		SizeType mi = lo + (hi - lo) / 2;
-		auto ul = get_left_index(u, lo, hi), ur = get_right_index(u, lo, hi);
-		if (l <= mi) {
-			modify(l, r, val, ul, lo, mi);
-		}
-		if (mi < r) {
-			modify(l, r, val, ur, mi + 1, hi);
-		}
-		tree[u] = combinator(tree[ul], tree[ur]);
-	}
-
-	T query(SizeType l, SizeType r, size_t u, SizeType lo, SizeType hi) {
-		if (l <= lo && hi <= r) {
-			return tree[u];
-		}
-		push(u, lo, hi);
-		SizeType mi = lo + (hi - lo) / 2;
-		auto ul = get_left_index(u, lo, hi), ur = get_right_index(u, lo, hi);
-		if (r <= mi) {
-			return query(l, r, ul, lo, mi);
-		}
-		if (mi < l) {
-			return query(l, r, ur, mi + 1, hi);
-		}
-		return combinator(query(l, r, ul, lo, mi), query(l, r, ur, mi + 1, hi));
+		auto mi = lo + (hi - lo) / 2;
+		auto ul = get_left_index(p, lo, hi), ur = get_right_index(p, lo, hi);
+		// creating the children may move the arena, so the tag is read after
+		auto val = tag::get(nodes[p].lazy);
+		apply(ul, *val, lo, mi);
+		apply(ur, *val, mi + 1, hi);
+		nodes[p].lazy = tag::empty();
 	}
 
   public:
-	explicit dynamic_segment_tree(
-	    SizeType n, const std::function<T(SizeType, SizeType)> &initializer,
-	    CombineOp combinator = {}, UpdateOp updater = {},
-	    CombineUpdateOp lazyCombinator = {}, UpdateLenOp updaterLen = {})
+	explicit dynamic_segment_tree(SizeType n, Initializer initializer,
+	                              CombineOp combinator = {},
+	                              UpdateOp updater = {},
+	                              CombineUpdateOp lazyCombinator = {},
+	                              UpdateLenOp updaterLen = {})
 	    : n(n), initializer(initializer), combinator(combinator),
 	      updater(updater), lazyCombinator(lazyCombinator),
 	      updaterLen(updaterLen) {
-		root = create_node(0, n - 1);
+		create_node(0, n - 1);
 	}
 	explicit dynamic_segment_tree(SizeType n, const T &init = {},
 	                              CombineOp combinator = {},
 	                              UpdateOp updater = {},
 	                              CombineUpdateOp lazyCombinator = {},
 	                              UpdateLenOp updaterLen = {})
-	    : dynamic_segment_tree(
-	          n, [init](size_t, size_t) { return init; }, combinator, updater,
-	          lazyCombinator, updaterLen) {}
+	    requires std::constructible_from<Initializer, const T &>
+	    : dynamic_segment_tree(n, Initializer{init}, combinator, updater,
+	                           lazyCombinator, updaterLen) {}
 	explicit dynamic_segment_tree(const std::vector<T> &init,
 	                              CombineOp combinator = {},
 	                              UpdateOp updater = {},
 	                              CombineUpdateOp lazyCombinator = {},
 	                              UpdateLenOp updaterLen = {})
-	    : dynamic_segment_tree(
-	          init.size(), [init](size_t u, size_t) { return init[u]; },
-	          combinator, updater, lazyCombinator, updaterLen) {
-		build(init, root, 0, n - 1);
+	    requires std::default_initializable<Initializer>
+	    : dynamic_segment_tree(init.size(), Initializer{}, combinator,
+	                           updater, lazyCombinator, updaterLen) {
+		reserve(2 * init.size());
+		build(init);
+	}
+
+	// reserves the arena, each update creates at most 4 log2(n) nodes
+	void reserve(size_t capacity) { nodes.reserve(capacity); }
+
+	// drops every node but a fresh root, the arena memory is kept
+	void clear() {
+		nodes.clear();
+		create_node(0, n - 1);
 	}
+
+	// reuses the arena for a tree over a new range and initializer
+	void reset(SizeType new_n, Initializer new_initializer) {
+		n = new_n;
+		initializer = new_initializer;
+		clear();
+	}
+
 	void modify(SizeType l, SizeType r, const U &val) {
-		modify(l, r, val, get_root_index(), 0, n - 1);
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			if (expanded) {
+				auto ul = nodes[u].left_child, ur = nodes[u].right_child;
+				nodes[u].value = combinator(nodes[ul].value, nodes[ur].value);
+				continue;
+			}
+			if (l <= lo && hi <= r) {
+				apply(u, val, lo, hi);
+				continue;
+			}
+			push(u, lo, hi);
+			SizeType mi = lo + (hi - lo) / 2;
+			auto ul = get_left_index(u, lo, hi),
+			     ur = get_right_index(u, lo, hi);
+			stk[top++] = {u, lo, hi, true};
+			if (mi < r)
+				stk[top++] = {ur, mi + 1, hi, false};
+			if (l <= mi)
+				stk[top++] = {ul, lo, mi, false};
+		}
 	}
 
 	T query(SizeType l, SizeType r) {
-		return query(l, r, get_root_index(), 0, n - 1);
+		fn::fold_result<CombineOp, T> res;
+		stack stk;
+		size_t top = 0;
+		stk[top++] = {get_root_index(), 0, n - 1, false};
+		while (top) {
+			auto [u, lo, hi, expanded] = stk[--top];
+			while (l > lo || hi > r) {
+				push(u, lo, hi);
+				SizeType mi = lo + (hi - lo) / 2;
+				if (mi < l) {
+					u = get_right_index(u, lo, hi), lo = mi + 1;
+					continue;
+				}
+				if (mi < r)
+					stk[top++] = {get_right_index(u, lo, hi), mi + 1, hi,
+					              false};
+				u = get_left_index(u, lo, hi), hi = mi;
+			}
+			res.add(nodes[u].value, combinator);
+		}
+		return res.value();
+	}
+};
+
+/**
+ * Persistent segment tree on a node arena with 32-bit child indices. Every
+ * point update copies the O(log n) nodes on its path and returns the id of
+ * the new version, all earlier versions remain queryable.
+ */
+template <class T, class U = T, class CombineOp = std::plus<>,
+          class UpdateOp = std::plus<>, std::integral SizeType = size_t>
+class persistent_segment_tree {
+	struct node {
+		T value;
+		uint32_t left_child, right_child;
+	};
+
+	SizeType n;
+	node_arena<node> nodes;
+	std::vector<uint32_t> roots;
+	CombineOp combinator;
+	UpdateOp updater;
+
+  public:
+	static constexpr SizeType npos = -1;
+
+  private:
+	uint32_t create_node(const T &val, uint32_t ul, uint32_t ur) {
+		return nodes.create({val, ul, ur});
+	}
+
+	uint32_t build(const std::vector<T> &init, SizeType lo, SizeType hi) {
+		if (lo == hi)
+			return create_node(init[lo], 0, 0);
+		SizeType mi = lo + (hi - lo) / 2;
+		auto ul = build(init, lo, mi), ur = build(init, mi + 1, hi);
+		return create_node(combinator(nodes[ul].value, nodes[ur].value), ul,
+		                   ur);
+	}
+
+	uint32_t modify(SizeType p, const U &val, uint32_t u, SizeType lo,
+	                SizeType hi) {
+		if (lo == hi)
+			return create_node(updater(nodes[u].value, val), 0, 0);
+		SizeType mi = lo + (hi - lo) / 2;
+		auto ul = nodes[u].left_child, ur = nodes[u].right_child;
+		if (p <= mi) {
+			ul = modify(p, val, ul, lo, mi);
+		} else {
+			ur = modify(p, val, ur, mi + 1, hi);
+		}
+		return create_node(combinator(nodes[ul].value, nodes[ur].value), ul,
+		                   ur);
+	}
+
+	T query(SizeType l, SizeType r, uint32_t u, SizeType lo,
+	        SizeType hi) const {
+		if (l <= lo && hi <= r) {
+			return nodes[u].value;
+		}
+		SizeType mi = lo + (hi - lo) / 2;
+		if (r <= mi) {
+			return query(l, r, nodes[u].left_child, lo, mi);
+		}
+		if (mi < l) {
+			return query(l, r, nodes[u].right_child, mi + 1, hi);
+		}
+		return combinator(query(l, r, nodes[u].left_child, lo, mi),
+		                  query(l, r, nodes[u].right_child, mi + 1, hi));
+	}
+
+  public:
+	explicit persistent_segment_tree(const std::vector<T> &init,
+	                                 CombineOp combinator = {},
+	                                 UpdateOp updater = {})
+	    : n(init.size()), combinator(combinator), updater(updater) {
+		reserve(2 * init.size());
+		roots.push_back(build(init, 0, n - 1));
+	}
+	explicit persistent_segment_tree(SizeType n, const T &init = {},
+	                                 CombineOp combinator = {},
+	                                 UpdateOp updater = {})
+	    : persistent_segment_tree(std::vector<T>(n, init), combinator,
+	                              updater) {}
+
+	// reserves the arena for the given number of nodes, each update adds
+	// about log2(n) + 1 of them
+	void reserve(size_t capacity) { nodes.reserve(capacity); }
+
+	SizeType size() const { return n; }
+
+	size_t versions() const { return roots.size(); }
+
+	// applies the update on top of version and returns the new version
+	size_t modify(size_t version, SizeType p, const U &val) {
+		roots.push_back(modify(p, val, roots[version], 0, n - 1));
+		return roots.size() - 1;
+	}
+
+	T query(size_t version, SizeType l, SizeType r) const {
+		return query(l, r, roots[version], 0, n - 1);
+	}
+
+	/**
+	 * Smallest p such that the difference between version hi and version lo
+	 * over [0, p] exceeds k, i.e. the k-th (0-indexed) element when the tree
+	 * counts occurrences. Returns npos if the whole difference is at most k.
+	 */
+	SizeType kth(size_t lo_version, size_t hi_version, T k) const
+	    requires fn::group<CombineOp, T> && std::totally_ordered<T>
+	{
+		auto inverse = fn::inverse_element<CombineOp, T>::value;
+		uint32_t u = roots[lo_version], v = roots[hi_version];
+		if (!(k < combinator(nodes[v].value, inverse(nodes[u].value))))
+			return npos;
+		SizeType lo = 0, hi = n - 1;
+		while (lo < hi) {
+			SizeType mi = lo + (hi - lo) / 2;
+			const node &x = nodes[u], &y = nodes[v];
+			T left = combinator(nodes[y.left_child].value,
+			                    inverse(nodes[x.left_child].value));
+			if (k < left) {
+				u = x.left_child, v = y.left_child, hi = mi;
+			} else {
+				k = combinator(k, inverse(left));
+				u = x.right_child, v = y.right_child, lo = mi + 1;
+			}
+		}
+		return lo;
+	}
+};
+
+/**
+ * Forest of sparse segment trees sharing one node arena, meant for
+ * value-indexed multisets. A tree is the id of its root and the empty tree
+ * is 0. Merging consumes both operands and costs the number of overlapping
+ * nodes, so merging all trees of a tree DP is O(n log n) in total.
+ */
+template <class T, class U = T, class CombineOp = std::plus<>,
+          class UpdateOp = std::plus<>, std::integral SizeType = size_t>
+class mergeable_segment_tree {
+  public:
+	using tree_id = uint32_t;
+	static constexpr tree_id empty_tree = 0;
+
+  private:
+	// node 0 is the empty tree, its value is the identity and both of its
+	// children point back to itself
+	struct node {
+		T value;
+		uint32_t left_child, right_child;
+	};
+
+	SizeType n;
+	node_arena<node> nodes;
+	T identity;
+	CombineOp combinator;
+	UpdateOp updater;
+
+	uint32_t create_node() { return nodes.create({identity, 0, 0}); }
+
+	// recomputes an inner node, dropping it once both children are empty
+	uint32_t pull(uint32_t u) {
+		if (!nodes[u].left_child && !nodes[u].right_child) {
+			nodes.release(u);
+			return 0;
+		}
+		nodes[u].value = combinator(nodes[nodes[u].left_child].value,
+		                            nodes[nodes[u].right_child].value);
+		return u;
+	}
+
+	uint32_t modify(uint32_t u, SizeType p, const U &val, SizeType lo,
+	                SizeType hi) {
+		if (!u)
+			u = create_node();
+		if (lo == hi) {
+			nodes[u].value = updater(nodes[u].value, val);
+			return u;
+		}
+		SizeType mi = lo + (hi - lo) / 2;
+		if (p <= mi) {
+			uint32_t ul = modify(nodes[u].left_child, p, val, lo, mi);
+			nodes[u].left_child = ul;
+		} else {
+			uint32_t ur = modify(nodes[u].right_child, p, val, mi + 1, hi);
+			nodes[u].right_child = ur;
+		}
+		return pull(u);
+	}
+
+	T query(uint32_t u, SizeType l, SizeType r, SizeType lo,
+	        SizeType hi) const {
+		if (!u || (l <= lo && hi <= r)) {
+			return nodes[u].value;
+		}
+		SizeType mi = lo + (hi - lo) / 2;
+		if (r <= mi) {
+			return query(nodes[u].left_child, l, r, lo, mi);
+		}
+		if (mi < l) {
+			return query(nodes[u].right_child, l, r, mi + 1, hi);
+		}
+		return combinator(query(nodes[u].left_child, l, r, lo, mi),
+		                  query(nodes[u].right_child, l, r, mi + 1, hi));
+	}
+
+	uint32_t merge(uint32_t u, uint32_t v, SizeType lo, SizeType hi) {
+		if (!u || !v)
+			return u | v;
+		if (lo == hi) {
+			nodes[u].value = combinator(nodes[u].value, nodes[v].value);
+		} else {
+			SizeType mi = lo + (hi - lo) / 2;
+			nodes[u].left_child =
+			    merge(nodes[u].left_child, nodes[v].left_child, lo, mi);
+			nodes[u].right_child =
+			    merge(nodes[u].right_child, nodes[v].right_child, mi + 1, hi);
+			nodes[u].value = combinator(nodes[nodes[u].left_child].value,
+			                            nodes[nodes[u].right_child].value);
+		}
+		nodes.release(v);
+		return u;
+	}
+
+	std::pair<uint32_t, uint32_t> split(uint32_t u, SizeType k, SizeType lo,
+	                                    SizeType hi) {
+		if (!u || hi < k)
+			return {u, 0};
+		if (k <= lo)
+			return {0, u};
+		// lo < k <= hi, so u is an inner node that is cut in two
+		SizeType mi = lo + (hi - lo) / 2;
+		uint32_t v = create_node();
+		if (k <= mi) {
+			auto [ll, lr] = split(nodes[u].left_child, k, lo, mi);
+			nodes[u].left_child = ll, nodes[v].left_child = lr;
+			nodes[v].right_child = nodes[u].right_child;
+			nodes[u].right_child = 0;
+		} else {
+			auto [rl, rr] = split(nodes[u].right_child, k, mi + 1, hi);
+			nodes[u].right_child = rl, nodes[v].right_child = rr;
+		}
+		return {pull(u), pull(v)};
+	}
+
+  public:
+	explicit mergeable_segment_tree(
+	    SizeType n, const T &identity = fn::default_identity<CombineOp, T>(),
+	    CombineOp combinator = {}, UpdateOp updater = {})
+	    : n(n), identity(identity), combinator(combinator), updater(updater) {
+		create_node();
+	}
+
+	// reserves the arena, an insertion or a split adds at most log2(n) + 1
+	// nodes while merges only release them
+	void reserve(size_t capacity) { nodes.reserve(capacity); }
+
+	SizeType size() const { return n; }
+
+	// applies the update at position p of tree t and returns its new root
+	tree_id modify(tree_id t, SizeType p, const U &val) {
+		return modify(t, p, val, 0, n - 1);
+	}
+
+	T query(tree_id t, SizeType l, SizeType r) const {
+		return query(t, l, r, 0, n - 1);
+	}
+
+	// combines the two trees position by position, both ids are consumed
+	tree_id merge(tree_id t, tree_id other) {
+		return merge(t, other, 0, n - 1);
+	}
+
+	// cuts t into the positions below k and the positions from k onwards
+	std::pair<tree_id, tree_id> split(tree_id t, SizeType k) {
+		return split(t, k, 0, n - 1);
 	}
 };
 
@@ -1,8 +1,13 @@
 #include "classic_segment_tree.hpp"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <tuple>
 #include <vector>
 
 #include "functional.hpp"
@@ -243,6 +248,128 @@ TEST_CASE("classic_lazy_segment_tree: first i where v[i] >= k query, range add "
 	REQUIRE(st.find(1, 3, 6, std::ranges::greater_equal{}) == 2);
 }
 
+TEST_CASE("segment_tree_beats: range chmin, chmax and add",
+          "[classic_segment_tree]") {
+	segment_tree_beats<long long> st(std::vector<long long>{5, 1, 4, 2, 3});
+	REQUIRE(st.query_sum(0, 4) == 15);
+	st.chmin(0, 2, 3);
+	REQUIRE(st.query_sum(0, 4) == 12);
+	REQUIRE(st.query_max(0, 4) == 3);
+	st.chmax(1, 4, 3);
+	REQUIRE(st.query_sum(0, 4) == 15);
+	REQUIRE(st.query_min(0, 4) == 3);
+	st.add(2, 3, -5);
+	REQUIRE(st.query_sum(0, 4) == 5);
+	REQUIRE(st.query_min(1, 4) == -2);
+	REQUIRE(st.query_max(2, 3) == -2);
+}
+
+TEST_CASE("segment_tree_beats: chmin and chmax to the extreme values",
+          "[classic_segment_tree]") {
+	const long long lo = std::numeric_limits<long long>::lowest(),
+	                hi = std::numeric_limits<long long>::max();
+	segment_tree_beats<long long> st(std::vector<long long>{5, 1, 4});
+	st.chmin(1, 1, lo);
+	REQUIRE(st.query_min(0, 2) == lo);
+	REQUIRE(st.query_max(0, 2) == 5);
+	REQUIRE(st.query_sum(1, 1) == lo);
+	REQUIRE(st.query_sum(2, 2) == 4);
+	segment_tree_beats<long long> st2(std::vector<long long>{-5, -1, -4});
+	st2.chmax(0, 0, hi);
+	REQUIRE(st2.query_max(0, 2) == hi);
+	REQUIRE(st2.query_min(0, 2) == -4);
+	REQUIRE(st2.query_sum(0, 0) == hi);
+	REQUIRE(st2.query_sum(1, 2) == -5);
+	segment_tree_beats<int> one(std::vector<int>{7});
+	one.chmin(0, 0, std::numeric_limits<int>::lowest());
+	REQUIRE(one.query_sum(0, 0) == std::numeric_limits<int>::lowest());
+	one.chmax(0, 0, std::numeric_limits<int>::max());
+	REQUIRE(one.query_sum(0, 0) == std::numeric_limits<int>::max());
+}
+
+TEST_CASE("segment_tree_beats: repeated add and chmin near the maximum",
+          "[classic_segment_tree]") {
+	// every sum fits in int, but the adds alone would overflow if they were
+	// kept piling up in the tags
+	std::mt19937 rng(13);
+	for (int n : {1, 2, 5, 64}) {
+		const int hi = std::numeric_limits<int>::max() / n, step = hi / 2;
+		std::vector<int> v(n);
+		segment_tree_beats<int> st(v);
+		for (int it = 0; it < 500; it++) {
+			int a = rng() % step, c = rng() % (hi - step + 1);
+			int l = rng() % n, r = rng() % n;
+			if (l > r)
+				std::swap(l, r);
+			st.add(0, n - 1, a);
+			st.chmin(0, n - 1, c);
+			st.chmin(l, r, c / 2);
+			for (int i = 0; i < n; i++)
+				v[i] = std::min(v[i] + a, c);
+			for (int i = l; i <= r; i++)
+				v[i] = std::min(v[i], c / 2);
+			int i = rng() % n;
+			REQUIRE(st.query_sum(i, i) == v[i]);
+			REQUIRE(st.query_sum(0, n - 1) ==
+			        std::accumulate(v.begin(), v.end(), 0));
+			REQUIRE(st.query_max(0, n - 1) ==
+			        *std::max_element(v.begin(), v.end()));
+			REQUIRE(st.query_min(0, n - 1) ==
+			        *std::min_element(v.begin(), v.end()));
+		}
+	}
+}
+
+TEST_CASE("segment_tree_beats: matches brute force on random operations",
+          "[classic_segment_tree]") {
+	std::mt19937 rng(11);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	for (int n : {1, 2, 7, 64, 100}) {
+		std::vector<long long> v(n);
+		for (auto &x : v)
+			x = (long long)rnd(200) - 100;
+		segment_tree_beats<long long> st(v);
+		for (int it = 0; it < 2000; it++) {
+			int l = rnd(n), r = rnd(n);
+			if (l > r)
+				std::swap(l, r);
+			long long val = (long long)rnd(200) - 100;
+			switch (rnd(6)) {
+			case 0:
+				st.chmin(l, r, val);
+				for (int i = l; i <= r; i++)
+					v[i] = std::min(v[i], val);
+				break;
+			case 1:
+				st.chmax(l, r, val);
+				for (int i = l; i <= r; i++)
+					v[i] = std::max(v[i], val);
+				break;
+			case 2:
+				st.add(l, r, val / 10);
+				for (int i = l; i <= r; i++)
+					v[i] += val / 10;
+				break;
+			case 3: {
+				long long sum = 0;
+				for (int i = l; i <= r; i++)
+					sum += v[i];
+				REQUIRE(st.query_sum(l, r) == sum);
+				break;
+			}
+			case 4:
+				REQUIRE(st.query_min(l, r) ==
+				        *std::min_element(v.begin() + l, v.begin() + r + 1));
+				break;
+			case 5:
+				REQUIRE(st.query_max(l, r) ==
+				        *std::max_element(v.begin() + l, v.begin() + r + 1));
+				break;
+			}
+		}
+	}
+}
+
 TEST_CASE("dynamic_segment_tree: range max query, range add update",
           "[classic_segment_tree]") {
 	std::vector<int> v{3, 2, 8, 5};
@@ -413,3 +540,440 @@ TEST_CASE(
 	        [](long long lo, long long hi) { return 3 * (hi - lo + 1); });
 	REQUIRE(st2.query(1'000'000'000LL, 4'000'000'000LL) == 9'000'000'003LL);
 }
+
+TEST_CASE("dynamic_segment_tree: arena reuse with clear and reset",
+          "[classic_segment_tree]") {
+	const long long n = 1'000'000'000'000'000'000LL;
+	auto ones = [](long long lo, long long hi) { return hi - lo + 1; };
+	dynamic_segment_tree<long long, long long, std::plus<>, std::plus<>,
+	                     std::plus<>, std::multiplies<>, long long,
+	                     decltype(ones)>
+	    st(n, ones);
+	st.reserve(1 << 12);
+	st.modify(0, n / 2, 2);
+	REQUIRE(st.query(n / 2 - 1, n / 2 + 1) == 7);
+	st.clear();
+	REQUIRE(st.query(n / 2 - 1, n / 2 + 1) == 3);
+	st.modify(5, 5, 10);
+	REQUIRE(st.query(0, 9) == 20);
+	st.reset(100, ones);
+	REQUIRE(st.query(0, 99) == 100);
+	st.modify(10, 19, -2);
+	REQUIRE(st.query(0, 99) == 80);
+}
+
+TEST_CASE("dynamic_segment_tree large range benchmark",
+          "[classic_segment_tree][.][benchmark]") {
+	const long long n = 1'000'000'000'000'000'000LL;
+	const int q = 5'000;
+	std::vector<std::tuple<long long, long long, int>> ops(q);
+	std::mt19937_64 rng(0);
+	auto rnd = [&] { return (long long)(rng() >> 4) % n; };
+	for (auto &[l, r, val] : ops) {
+		l = rnd(), r = rnd(), val = rnd() % 1000;
+		if (l > r)
+			std::swap(l, r);
+	}
+	using tree = dynamic_segment_tree<int, int, fn::maximum<>, std::plus<>,
+	                                  std::plus<>, fn::noop, long long>;
+	auto run = [&](tree &st) {
+		long long res = 0;
+		for (auto [l, r, val] : ops) {
+			st.modify(l, r, val);
+			res += st.query(l, r);
+		}
+		return res;
+	};
+	BENCHMARK("fresh tree") {
+		tree st(n);
+		return run(st);
+	};
+	tree reused(n);
+	reused.reserve(size_t(q) * 4 * 60);
+	BENCHMARK("reused arena") {
+		reused.clear();
+		return run(reused);
+	};
+}
+
+TEST_CASE("classic segment trees match brute force on random operations",
+          "[classic_segment_tree]") {
+	std::mt19937 rng(7);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	for (int n : {1, 2, 3, 5, 17, 100}) {
+		std::vector<long long> v(n);
+		for (auto &x : v)
+			x = rnd(100);
+		classic_segment_tree<long long, long long, fn::maximum<>> st(v);
+		classic_lazy_segment_tree<long long, long long, fn::maximum<>> lst(v);
+		dynamic_segment_tree<long long, long long, fn::maximum<>> dst(v);
+		for (int it = 0; it < 300; it++) {
+			int l = rnd(n), r = rnd(n);
+			if (l > r)
+				std::swap(l, r);
+			long long val = rnd(20);
+			if (it % 2) {
+				for (int i = l; i <= r; i++) {
+					v[i] += val;
+					st.modify(i, val);
+				}
+				lst.modify(l, r, val);
+				dst.modify(l, r, val);
+			}
+			long long mx = *std::max_element(v.begin() + l, v.begin() + r + 1);
+			REQUIRE(st.query(l, r) == mx);
+			REQUIRE(lst.query(l, r) == mx);
+			REQUIRE(dst.query(l, r) == mx);
+			long long k = rnd(20) + mx - 10;
+			auto it_k = std::find_if(v.begin() + l, v.begin() + r + 1,
+			                         [k](long long x) { return x >= k; });
+			size_t expected = it_k == v.begin() + r + 1 ? decltype(st)::npos
+			                                            : it_k - v.begin();
+			auto pred = [k](long long x) { return x >= k; };
+			REQUIRE(st.find(l, r, pred) == expected);
+			REQUIRE(lst.find(l, r, pred) == expected);
+		}
+	}
+}
+
+// the recursive traversals the classic trees used before the explicit
+// stacks, on the same 2n layout, as a baseline
+template <class Op> struct recursive_segment_tree {
+	static constexpr size_t npos = -1;
+	size_t n;
+	std::vector<long long> tree, lazy;
+	Op op;
+
+	static size_t right(size_t p, size_t lo, size_t hi) {
+		return p + ((hi - lo) / 2 + 1) * 2;
+	}
+
+	explicit recursive_segment_tree(const std::vector<long long> &init)
+	    : n(init.size()), tree(n + n), lazy(n + n) {
+		build(init, 0, 0, n - 1);
+	}
+
+	void build(const std::vector<long long> &init, size_t p, size_t lo,
+	           size_t hi) {
+		if (lo == hi) {
+			tree[p] = init[lo];
+			return;
+		}
+		size_t mi = lo + (hi - lo) / 2;
+		build(init, p + 1, lo, mi);
+		build(init, right(p, lo, hi), mi + 1, hi);
+		tree[p] = op(tree[p + 1], tree[right(p, lo, hi)]);
+	}
+
+	void modify(size_t i, long long val, size_t p, size_t lo, size_t hi) {
+		if (lo == hi) {
+			tree[p] += val;
+			return;
+		}
+		size_t mi = lo + (hi - lo) / 2;
+		if (i <= mi)
+			modify(i, val, p + 1, lo, mi);
+		else
+			modify(i, val, right(p, lo, hi), mi + 1, hi);
+		tree[p] = op(tree[p + 1], tree[right(p, lo, hi)]);
+	}
+
+	// lazy range add, the tag is added once per node as with fn::noop
+	void apply(size_t p, long long val) { tree[p] += val, lazy[p] += val; }
+
+	void push(size_t p, size_t lo, size_t hi) {
+		if (lazy[p]) {
+			apply(p + 1, lazy[p]), apply(right(p, lo, hi), lazy[p]);
+			lazy[p] = 0;
+		}
+	}
+
+	void modify(size_t l, size_t r, long long val, size_t p, size_t lo,
+	            size_t hi) {
+		if (l <= lo && hi <= r) {
+			apply(p, val);
+			return;
+		}
+		push(p, lo, hi);
+		size_t mi = lo + (hi - lo) / 2;
+		if (l <= mi)
+			modify(l, r, val, p + 1, lo, mi);
+		if (mi < r)
+			modify(l, r, val, right(p, lo, hi), mi + 1, hi);
+		tree[p] = op(tree[p + 1], tree[right(p, lo, hi)]);
+	}
+
+	long long query(size_t l, size_t r, size_t p, size_t lo, size_t hi) {
+		if (l <= lo && hi <= r)
+			return tree[p];
+		push(p, lo, hi);
+		size_t mi = lo + (hi - lo) / 2;
+		if (r <= mi)
+			return query(l, r, p + 1, lo, mi);
+		if (mi < l)
+			return query(l, r, right(p, lo, hi), mi + 1, hi);
+		return op(query(l, r, p + 1, lo, mi),
+		          query(l, r, right(p, lo, hi), mi + 1, hi));
+	}
+
+	template <class Pred>
+	size_t find(size_t l, size_t p, size_t lo, size_t hi, Pred &pred) {
+		if (hi < l || !pred(tree[p]))
+			return npos;
+		if (lo == hi)
+			return lo;
+		push(p, lo, hi);
+		size_t mi = lo + (hi - lo) / 2;
+		if (size_t res = find(l, p + 1, lo, mi, pred); res != npos)
+			return res;
+		return find(l, right(p, lo, hi), mi + 1, hi, pred);
+	}
+
+	void modify(size_t i, long long val) { modify(i, val, 0, 0, n - 1); }
+	void modify(size_t l, size_t r, long long val) {
+		modify(l, r, val, 0, 0, n - 1);
+	}
+	long long query(size_t l, size_t r) { return query(l, r, 0, 0, n - 1); }
+	template <class Pred> size_t find(size_t l, size_t r, Pred pred) {
+		size_t res = find(l, 0, 0, n - 1, pred);
+		return res <= r ? res : npos;
+	}
+};
+
+TEST_CASE("classic segment tree traversal benchmark",
+          "[classic_segment_tree][.][benchmark]") {
+	// every operation is timed on the explicit-stack trees and on
+	// recursive_segment_tree
+	const int n = 1 << 16, q = 1 << 14;
+	std::mt19937 rng(1);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	std::vector<long long> v(n);
+	for (auto &x : v)
+		x = rnd(1000);
+	std::vector<std::pair<int, int>> ranges(q);
+	for (auto &[l, r] : ranges) {
+		l = rnd(n), r = rnd(n);
+		if (l > r)
+			std::swap(l, r);
+	}
+	using recursive_sum = recursive_segment_tree<std::plus<>>;
+	using recursive_max = recursive_segment_tree<fn::maximum<>>;
+	BENCHMARK("build") { return classic_segment_tree<long long>(v).size(); };
+	BENCHMARK("recursive build") { return recursive_sum(v).n; };
+	classic_segment_tree<long long> st(v);
+	recursive_sum rst(v);
+	BENCHMARK("point modify") {
+		for (auto [l, r] : ranges)
+			st.modify(l, r & 7);
+		return st.query(0, n - 1);
+	};
+	BENCHMARK("recursive point modify") {
+		for (auto [l, r] : ranges)
+			rst.modify(size_t(l), r & 7);
+		return rst.query(0, n - 1);
+	};
+	BENCHMARK("range query") {
+		long long res = 0;
+		for (auto [l, r] : ranges)
+			res += st.query(l, r);
+		return res;
+	};
+	BENCHMARK("recursive range query") {
+		long long res = 0;
+		for (auto [l, r] : ranges)
+			res += rst.query(l, r);
+		return res;
+	};
+	classic_segment_tree<long long, long long, fn::maximum<>> mx(v);
+	recursive_max rmx(v);
+	auto at_least = [](long long x) { return x >= 999; };
+	BENCHMARK("find") {
+		size_t res = 0;
+		for (auto [l, r] : ranges)
+			res += mx.find(l, n - 1, at_least);
+		return res;
+	};
+	BENCHMARK("recursive find") {
+		size_t res = 0;
+		for (auto [l, r] : ranges)
+			res += rmx.find(l, n - 1, at_least);
+		return res;
+	};
+	classic_lazy_segment_tree<long long> lst(v);
+	recursive_sum rlst(v);
+	BENCHMARK("lazy range modify and query") {
+		long long res = 0;
+		for (auto [l, r] : ranges) {
+			lst.modify(l, r, 1);
+			res += lst.query(l, r);
+		}
+		return res;
+	};
+	BENCHMARK("recursive lazy range modify and query") {
+		long long res = 0;
+		for (auto [l, r] : ranges) {
+			rlst.modify(l, r, 1);
+			res += rlst.query(l, r);
+		}
+		return res;
+	};
+	for (auto [l, r] : ranges) {
+		REQUIRE(st.query(l, r) == rst.query(l, r));
+		REQUIRE(mx.find(l, n - 1, at_least) == rmx.find(l, n - 1, at_least));
+	}
+}
+
+TEST_CASE("persistent_segment_tree: range sum query on every version",
+          "[classic_segment_tree]") {
+	std::vector<int> v{3, 2, 8, 5};
+	persistent_segment_tree<int> st(v);
+	auto v1 = st.modify(0, 1, 10);
+	auto v2 = st.modify(v1, 3, -5);
+	auto v3 = st.modify(0, 2, 1);
+	REQUIRE(st.versions() == 4);
+	REQUIRE(st.query(0, 0, 3) == 18);
+	REQUIRE(st.query(v1, 0, 3) == 28);
+	REQUIRE(st.query(v2, 1, 3) == 20);
+	REQUIRE(st.query(v3, 1, 3) == 16);
+	REQUIRE(st.query(v3, 2, 2) == 9);
+	REQUIRE(st.query(v2, 2, 2) == 8);
+}
+
+TEST_CASE("persistent_segment_tree: k-th smallest in a subarray",
+          "[classic_segment_tree]") {
+	const int n = 60, m = 20;
+	std::mt19937 rng(5);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	std::vector<int> a(n);
+	for (auto &x : a)
+		x = rnd(m);
+	// version i counts the values of the prefix a[0, i)
+	persistent_segment_tree<int> st(m);
+	st.reserve(m * 2 + n * 6);
+	for (int i = 0; i < n; i++)
+		st.modify(i, a[i], 1);
+	for (int it = 0; it < 200; it++) {
+		int l = rnd(n), r = rnd(n);
+		if (l > r)
+			std::swap(l, r);
+		std::vector<int> sorted(a.begin() + l, a.begin() + r + 1);
+		std::sort(sorted.begin(), sorted.end());
+		int k = rnd(r - l + 1);
+		REQUIRE(st.kth(l, r + 1, k) == size_t(sorted[k]));
+		REQUIRE(st.kth(l, r + 1, r - l + 1) == st.npos);
+	}
+}
+
+TEST_CASE("mergeable_segment_tree: merge and split multisets",
+          "[classic_segment_tree]") {
+	mergeable_segment_tree<int> st(10);
+	auto a = st.modify(st.empty_tree, 3, 1);
+	a = st.modify(a, 7, 2);
+	auto b = st.modify(st.empty_tree, 3, 1);
+	b = st.modify(b, 5, 1);
+	auto t = st.merge(a, b);
+	REQUIRE(st.query(t, 0, 9) == 5);
+	REQUIRE(st.query(t, 3, 3) == 2);
+	REQUIRE(st.query(t, 4, 6) == 1);
+	auto [lo, hi] = st.split(t, 5);
+	REQUIRE(st.query(lo, 0, 9) == 2);
+	REQUIRE(st.query(hi, 0, 9) == 3);
+	REQUIRE(st.query(hi, 5, 5) == 1);
+	auto [none, all] = st.split(hi, 0);
+	REQUIRE(none == st.empty_tree);
+	REQUIRE(st.query(all, 0, 9) == 3);
+	REQUIRE(st.query(st.merge(lo, all), 0, 9) == 5);
+}
+
+TEST_CASE("mergeable_segment_tree: matches brute force on random operations",
+          "[classic_segment_tree]") {
+	std::mt19937 rng(5);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	const int n = 50, trees = 8;
+	mergeable_segment_tree<int, int, fn::maximum<>> st(n, 0);
+	std::vector<mergeable_segment_tree<int, int, fn::maximum<>>::tree_id>
+	    ids(trees, st.empty_tree);
+	std::vector<std::vector<int>> v(trees, std::vector<int>(n));
+	for (int it = 0; it < 3000; it++) {
+		int i = rnd(trees), j = rnd(trees);
+		switch (rnd(4)) {
+		case 0: {
+			int p = rnd(n), val = rnd(100);
+			ids[i] = st.modify(ids[i], p, val);
+			v[i][p] += val;
+			break;
+		}
+		case 1:
+			if (i == j)
+				break;
+			ids[i] = st.merge(ids[i], ids[j]);
+			ids[j] = st.empty_tree;
+			for (int p = 0; p < n; p++)
+				v[i][p] = std::max(v[i][p], v[j][p]), v[j][p] = 0;
+			break;
+		case 2: {
+			if (i == j)
+				break;
+			int k = rnd(n + 1);
+			ids[i] = st.merge(ids[i], ids[j]);
+			std::tie(ids[i], ids[j]) = st.split(ids[i], k);
+			for (int p = 0; p < n; p++) {
+				int x = std::max(v[i][p], v[j][p]);
+				v[i][p] = p < k ? x : 0, v[j][p] = p < k ? 0 : x;
+			}
+			break;
+		}
+		case 3: {
+			int l = rnd(n), r = rnd(n);
+			if (l > r)
+				std::swap(l, r);
+			REQUIRE(st.query(ids[i], l, r) ==
+			        *std::max_element(v[i].begin() + l, v[i].begin() + r + 1));
+			break;
+		}
+		}
+	}
+}
+
+TEST_CASE("mergeable_segment_tree benchmark",
+          "[classic_segment_tree][.][benchmark]") {
+	// merges the value sets of a random rooted tree bottom-up, compared with
+	// reinserting every element of the smaller child
+	const int n = 1 << 15;
+	std::mt19937 rng(3);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	std::vector<int> parent(n), value(n);
+	for (int i = 1; i < n; i++)
+		parent[i] = rnd(i);
+	for (auto &x : value)
+		x = rnd(n);
+	BENCHMARK("merge") {
+		mergeable_segment_tree<int> st(n);
+		st.reserve(size_t(n) * 17);
+		std::vector<uint32_t> root(n);
+		for (int i = 0; i < n; i++)
+			root[i] = st.modify(st.empty_tree, value[i], 1);
+		for (int i = n - 1; i > 0; i--)
+			root[parent[i]] = st.merge(root[parent[i]], root[i]);
+		return st.query(root[0], 0, n / 2);
+	};
+	BENCHMARK("small to large reinsertion") {
+		mergeable_segment_tree<int> st(n);
+		st.reserve(size_t(n) * 17);
+		std::vector<uint32_t> root(n);
+		std::vector<std::vector<int>> items(n);
+		for (int i = 0; i < n; i++) {
+			root[i] = st.modify(st.empty_tree, value[i], 1);
+			items[i] = {value[i]};
+		}
+		for (int i = n - 1; i > 0; i--) {
+			int p = parent[i];
+			if (items[p].size() < items[i].size())
+				std::swap(items[p], items[i]), std::swap(root[p], root[i]);
+			for (int x : items[i])
+				root[p] = st.modify(root[p], x, 1);
+			items[p].insert(items[p].end(), items[i].begin(), items[i].end());
+		}
+		return st.query(root[0], 0, n / 2);
+	};
+}
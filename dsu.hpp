@@ -6,19 +6,55 @@
 #ifndef DSU_HPP
 #define DSU_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <concepts>
 #include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <tuple>
 #include <utility>
 #include <vector>
 
-template <class T = void, class Op = std::plus<>> class dsu;
+/**
+ * Parents are stored as Index, negative values being the set size of a root.
+ * A narrower Index such as int16_t halves the memory traffic for small n.
+ */
+template <class T = void, class Op = std::plus<>,
+          std::signed_integral Index = int>
+class dsu;
 
-template <class Op> class dsu<void, Op> : std::vector<int> {
+// unions every edge through Dsu::union_sets, the one loop behind
+// union_sets_batch of both dsu specializations
+template <class Dsu>
+int dsu_union_sets_batch(Dsu &d,
+                         const std::vector<std::pair<int, int>> &edges) {
+	int merged = 0;
+	for (auto [u, v] : edges)
+		merged += d.union_sets(u, v) != Dsu::same_set;
+	return merged;
+}
+
+template <class Op, std::signed_integral Index>
+class dsu<void, Op, Index> : std::vector<Index> {
   public:
-	static const int same_set = -1;
+	static constexpr int same_set = -1;
 
-	explicit dsu(size_t n) : std::vector<int>(n, -1) {}
+	explicit dsu(size_t n) : std::vector<Index>(n, -1) {
+		// set sizes are stored negated, so every node must fit in Index
+		assert(n <= size_t(std::numeric_limits<Index>::max()));
+	}
 	int find_set(int x) {
-		return (*this)[x] >= 0 ? (*this)[x] = find_set((*this)[x]) : x;
+		auto &p = *this;
+		// iterative path halving
+		while (p[x] >= 0) {
+			if (p[p[x]] >= 0)
+				p[x] = p[p[x]];
+			x = p[x];
+		}
+		return x;
 	}
 	int size_of_set(int x) { return -(*this)[find_set(x)]; }
 	int union_sets(int u, int v) {
@@ -31,39 +67,296 @@ template <class Op> class dsu<void, Op> : std::vector<int> {
 		(*this)[gu] = gv;
 		return gv;
 	}
-	size_t size() const { return std::vector<int>::size(); }
+	// returns the number of edges that merged two sets
+	int union_sets_batch(const std::vector<std::pair<int, int>> &edges) {
+		return dsu_union_sets_batch(*this, edges);
+	}
+	size_t size() const { return std::vector<Index>::size(); }
 };
 
-template <class T, class Op> class dsu : public dsu<void, Op> {
+template <class T, class Op, std::signed_integral Index>
+class dsu : public dsu<void, Op, Index> {
 	std::vector<T> dat;
 	Op op;
 
   public:
-	using dsu<void, Op>::same_set;
+	using dsu<void, Op, Index>::same_set;
 
-	explicit dsu(const std::vector<T> &v, const Op &op = {})
-	    : dsu<void, Op>(v.size()), dat(v), op(op) {}
+	explicit dsu(std::vector<T> v, const Op &op = {})
+	    : dsu<void, Op, Index>(v.size()), dat(std::move(v)), op(op) {}
 	explicit dsu(size_t n, const T &init = {}, const Op &op = {})
 	    : dsu(std::vector<T>(n, init), op) {}
 
-	using dsu<void, Op>::find_set;
+	using dsu<void, Op, Index>::find_set;
 	const T &operator[](int x) const { return dat[find_set(x)]; }
 	T &operator[](int x) { return dat[find_set(x)]; }
 	int union_sets(int u, int v) {
 		int gu = find_set(u), gv = find_set(v);
-		int result = dsu<void, Op>::union_sets(gu, gv);
+		int result = dsu<void, Op, Index>::union_sets(gu, gv);
+		// moving lets containers such as magic_vector merge small-to-large
 		if (result != same_set)
-			dat[result] = op(dat[result], dat[result ^ gu ^ gv]);
+			dat[result] =
+			    op(std::move(dat[result]), std::move(dat[result ^ gu ^ gv]));
 		return result;
 	}
+	int union_sets_batch(const std::vector<std::pair<int, int>> &edges) {
+		return dsu_union_sets_batch(*this, edges);
+	}
+};
+
+/**
+ * DSU over an abelian group tracking the potential of each node relative to
+ * its root, for difference (std::plus<>) or parity (std::bit_xor<>)
+ * constraints between nodes.
+ */
+template <class T, class Op = std::plus<>, class Inverse = std::negate<>>
+class dsu_potential : std::vector<int> {
+	std::vector<T> diff;
+	std::vector<int> path;
+	Op op;
+	Inverse inverse;
+
+  public:
+	static constexpr int same_set = -1;
+	static constexpr int contradiction = -2;
+
+	explicit dsu_potential(size_t n, const Op &op = {},
+	                       const Inverse &inverse = {})
+	    : std::vector<int>(n, -1), diff(n), op(op), inverse(inverse) {}
+	int find_set(int x) {
+		auto &p = *this;
+		for (; p[x] >= 0; x = p[x])
+			path.push_back(x);
+		// the last node on the path is already a child of the root
+		for (int i = std::ssize(path) - 2; i >= 0; i--) {
+			diff[path[i]] = op(diff[path[i]], diff[path[i + 1]]);
+			p[path[i]] = x;
+		}
+		path.clear();
+		return x;
+	}
+	int size_of_set(int x) { return -(*this)[find_set(x)]; }
+	// potential of x minus potential of its root
+	T potential(int x) {
+		find_set(x);
+		return diff[x];
+	}
+	// potential of v minus potential of u, if they are in the same set
+	std::optional<T> difference(int u, int v) {
+		if (find_set(u) != find_set(v))
+			return std::nullopt;
+		return op(diff[v], inverse(diff[u]));
+	}
+	// constrains potential of v minus potential of u to be w
+	int union_sets(int u, int v, const T &w) {
+		int gu = find_set(u), gv = find_set(v);
+		if (gu == gv)
+			return op(diff[v], inverse(diff[u])) == w ? same_set
+			                                          : contradiction;
+		T d = op(op(w, diff[u]), inverse(diff[v]));
+		if ((*this)[gu] < (*this)[gv]) {
+			std::swap(gu, gv);
+			d = inverse(d);
+		}
+		(*this)[gv] += (*this)[gu];
+		(*this)[gu] = gv;
+		diff[gu] = inverse(d);
+		return gv;
+	}
+	size_t size() const { return std::vector<int>::size(); }
+};
+
+/**
+ * Partially persistent DSU: union by size without path compression, where
+ * each node remembers the version it was linked at, so connectivity can be
+ * queried at any past version in O(log n).
+ */
+class dsu_partially_persistent {
+	std::vector<int> parent, linked_at;
+	std::vector<std::vector<std::pair<int, int>>> size_history;
+	int now = 0;
+
+  public:
+	static constexpr int same_set = -1;
+	static constexpr int never = std::numeric_limits<int>::max();
+
+	explicit dsu_partially_persistent(size_t n)
+	    : parent(n), linked_at(n, never), size_history(n, {{0, 1}}) {
+		for (size_t i = 0; i < n; i++)
+			parent[i] = i;
+	}
+	int find_set(int x, int version) const {
+		while (linked_at[x] <= version)
+			x = parent[x];
+		return x;
+	}
+	int find_set(int x) const { return find_set(x, now); }
+	int size_of_set(int x, int version) const {
+		const auto &history = size_history[find_set(x, version)];
+		auto it = std::ranges::upper_bound(history, version, {},
+		                                   &std::pair<int, int>::first);
+		return std::prev(it)->second;
+	}
+	int size_of_set(int x) const { return size_of_set(x, now); }
+	// every call creates a new version, even if u and v are already joined
+	int union_sets(int u, int v) {
+		now++;
+		int gu = find_set(u), gv = find_set(v);
+		if (gu == gv)
+			return same_set;
+		int su = size_history[gu].back().second,
+		    sv = size_history[gv].back().second;
+		if (su > sv)
+			std::swap(gu, gv);
+		parent[gu] = gv;
+		linked_at[gu] = now;
+		size_history[gv].emplace_back(now, su + sv);
+		return gv;
+	}
+	size_t size() const { return parent.size(); }
+	int version() const { return now; }
+};
+
+/**
+ * Fully persistent DSU: union by size without path compression on top of a
+ * persistent array stored in a node pool with 32-bit child indices. Any
+ * version can be branched from. A find walks O(log n) parents, each read from
+ * the array in O(log n), so find_set, size_of_set and union_sets cost
+ * O(log^2 n), and each union allocates O(log n) nodes.
+ */
+class dsu_persistent {
+	int n;
+	// persistent array of parents, negative values being set sizes
+	std::vector<int> left_child, right_child, value, roots;
+
+	int create_node(int l, int r, int v) {
+		left_child.push_back(l);
+		right_child.push_back(r);
+		value.push_back(v);
+		return value.size() - 1;
+	}
+	int build(int lo, int hi) {
+		if (lo == hi)
+			return create_node(0, 0, -1);
+		int mi = lo + (hi - lo) / 2;
+		int l = build(lo, mi);
+		return create_node(l, build(mi + 1, hi), 0);
+	}
+	int get(int p, int x) const {
+		int lo = 0, hi = n - 1;
+		while (lo != hi) {
+			int mi = lo + (hi - lo) / 2;
+			if (x <= mi)
+				p = left_child[p], hi = mi;
+			else
+				p = right_child[p], lo = mi + 1;
+		}
+		return value[p];
+	}
+	int set(int p, int x, int v, int lo, int hi) {
+		if (lo == hi)
+			return create_node(0, 0, v);
+		int mi = lo + (hi - lo) / 2;
+		if (x <= mi)
+			return create_node(set(left_child[p], x, v, lo, mi),
+			                   right_child[p], 0);
+		return create_node(left_child[p],
+		                   set(right_child[p], x, v, mi + 1, hi), 0);
+	}
+
+  public:
+	explicit dsu_persistent(size_t n) : n(n) {
+		// an empty array still gets a root so that version 0 exists
+		roots.push_back(n > 0 ? build(0, n - 1) : create_node(0, 0, 0));
+	}
+	int find_set(int x, int version) const {
+		for (int p; (p = get(roots[version], x)) >= 0;)
+			x = p;
+		return x;
+	}
+	int size_of_set(int x, int version) const {
+		return -get(roots[version], find_set(x, version));
+	}
+	// joins u and v on top of version, returning the id of the new version
+	int union_sets(int u, int v, int version) {
+		int root = roots[version];
+		int gu = find_set(u, version), gv = find_set(v, version);
+		if (gu != gv) {
+			int su = get(root, gu), sv = get(root, gv);
+			if (su < sv)
+				std::swap(gu, gv), std::swap(su, sv);
+			root = set(root, gv, su + sv, 0, n - 1);
+			root = set(root, gu, gv, 0, n - 1);
+		}
+		roots.push_back(root);
+		return roots.size() - 1;
+	}
+	size_t size() const { return n; }
+	int version() const { return roots.size() - 1; }
+};
+
+/**
+ * Lock-free union-find safe to use from multiple threads (Anderson-Woll).
+ * Roots hold the negated set size and are linked by index with CAS so that
+ * concurrent unions never form a cycle; find_set splits paths with CAS.
+ */
+class concurrent_dsu : std::vector<std::atomic<int>> {
+  public:
+	static constexpr int same_set = -1;
+
+	explicit concurrent_dsu(size_t n) : std::vector<std::atomic<int>>(n) {
+		for (auto &p : *this)
+			p.store(-1, std::memory_order_relaxed);
+	}
+	int find_set(int x) {
+		auto &p = *this;
+		while (true) {
+			int px = p[x].load();
+			if (px < 0)
+				return x;
+			// path splitting, losing the race is harmless
+			if (int gx = p[px].load(); gx >= 0)
+				p[x].compare_exchange_weak(px, gx);
+			x = px;
+		}
+	}
+	int size_of_set(int x) {
+		while (true) {
+			int size = (*this)[find_set(x)].load();
+			if (size < 0)
+				return -size;
+		}
+	}
+	int union_sets(int u, int v) {
+		auto &p = *this;
+		while (true) {
+			u = find_set(u), v = find_set(v);
+			if (u == v)
+				return same_set;
+			if (u > v)
+				std::swap(u, v);
+			int size_u = p[u].load();
+			// fails if u has been linked or its size has changed meanwhile
+			if (size_u >= 0 || !p[u].compare_exchange_strong(size_u, v))
+				continue;
+			for (int r = v;;) {
+				int size_r = p[r].load();
+				if (size_r >= 0)
+					r = size_r;
+				else if (p[r].compare_exchange_weak(size_r, size_r + size_u))
+					return v;
+			}
+		}
+	}
+	size_t size() const { return std::vector<std::atomic<int>>::size(); }
 };
 
 class dsu_rollback : std::vector<int> {
 	std::vector<std::pair<int, int>> history;
 
   public:
-	static const int same_set = -1;
-	static const size_t last_version = -1;
+	static constexpr int same_set = -1;
+	static constexpr size_t last_version = -1;
 
 	explicit dsu_rollback(size_t n) : std::vector<int>(n, -1) {}
 	int find_set(int x) { return (*this)[x] >= 0 ? find_set((*this)[x]) : x; }
@@ -97,4 +390,90 @@ class dsu_rollback : std::vector<int> {
 	size_t version() const { return history.size(); }
 };
 
+/**
+ * Offline dynamic connectivity: edge insertions, deletions and connectivity
+ * queries are recorded in order, then answered together by distributing each
+ * edge's lifetime over a segment tree on the query timeline and traversing
+ * it with dsu_rollback, in O((n + q) log q log n).
+ */
+class offline_dynamic_connectivity {
+	size_t n;
+	std::map<std::pair<int, int>, std::vector<int>> alive;
+	std::vector<std::tuple<int, int, int, int>> lifetimes;
+	std::vector<std::pair<int, int>> queries;
+
+	static std::pair<int, int> normalize(int u, int v) {
+		return {std::min(u, v), std::max(u, v)};
+	}
+
+  public:
+	explicit offline_dynamic_connectivity(size_t n) : n(n) {}
+
+	void push_edge(int u, int v) {
+		alive[normalize(u, v)].push_back(queries.size());
+	}
+
+	// erasing an edge that is not present does nothing
+	void erase_edge(int u, int v) {
+		auto it = alive.find(normalize(u, v));
+		if (it == alive.end())
+			return;
+		lifetimes.emplace_back(it->second.back(), queries.size(),
+		                       it->first.first, it->first.second);
+		it->second.pop_back();
+		if (it->second.empty())
+			alive.erase(it);
+	}
+
+	void push_query(int u, int v) { queries.emplace_back(u, v); }
+
+	std::vector<bool> solve() const {
+		const int q = queries.size();
+		std::vector<bool> result(q);
+		if (q == 0)
+			return result;
+		// 2n memory layout, as in classic_segment_tree
+		std::vector<std::vector<std::pair<int, int>>> tree(2 * q);
+		auto insert = [&](auto &self, int l, int r, std::pair<int, int> e,
+		                  size_t p, int lo, int hi) -> void {
+			if (l <= lo && hi <= r) {
+				tree[p].push_back(e);
+				return;
+			}
+			int mi = lo + (hi - lo) / 2;
+			if (l <= mi)
+				self(self, l, r, e, p + 1, lo, mi);
+			if (mi < r)
+				self(self, l, r, e, p + (mi - lo + 1) * 2, mi + 1, hi);
+		};
+		auto insert_lifetime = [&](int from, int to, int u, int v) {
+			if (from < to)
+				insert(insert, from, to - 1, {u, v}, 0, 0, q - 1);
+		};
+		for (auto [from, to, u, v] : lifetimes)
+			insert_lifetime(from, to, u, v);
+		for (const auto &[e, starts] : alive) {
+			for (int from : starts)
+				insert_lifetime(from, q, e.first, e.second);
+		}
+		dsu_rollback d(n);
+		auto dfs = [&](auto &self, size_t p, int lo, int hi) -> void {
+			size_t version = d.version();
+			for (auto [u, v] : tree[p])
+				d.union_sets(u, v);
+			if (lo == hi) {
+				auto [u, v] = queries[lo];
+				result[lo] = d.find_set(u) == d.find_set(v);
+			} else {
+				int mi = lo + (hi - lo) / 2;
+				self(self, p + 1, lo, mi);
+				self(self, p + (mi - lo + 1) * 2, mi + 1, hi);
+			}
+			d.rollback(version);
+		};
+		dfs(dfs, 0, 0, q - 1);
+		return result;
+	}
+};
+
 #endif
@@ -1,7 +1,13 @@
 #include "dsu.hpp"
+#include "utilities.hpp"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstdint>
+#include <random>
+#include <thread>
+
 TEST_CASE("dsu behaves as expected", "[dsu]") {
 	dsu<> d(5);
 	SECTION("dsu constructed as expected") {
@@ -34,6 +40,27 @@ TEST_CASE("dsu behaves as expected", "[dsu]") {
 	}
 }
 
+TEST_CASE("dsu handles long chains", "[dsu]") {
+	const int n = 1'000'000;
+	dsu<> d(n);
+	std::vector<std::pair<int, int>> edges;
+	for (int i = 0; i + 1 < n; i++)
+		edges.emplace_back(i, i + 1);
+	REQUIRE(d.union_sets_batch(edges) == n - 1);
+	REQUIRE(d.size_of_set(0) == n);
+	REQUIRE(d.find_set(0) == d.find_set(n - 1));
+	REQUIRE(d.union_sets_batch(edges) == 0);
+}
+
+TEST_CASE("dsu with 16-bit storage", "[dsu]") {
+	dsu<void, std::plus<>, int16_t> d(5);
+	REQUIRE(d.union_sets_batch({{0, 1}, {1, 2}, {3, 4}, {0, 2}}) == 3);
+	REQUIRE(d.find_set(0) == 1);
+	REQUIRE(d.find_set(4) == 4);
+	REQUIRE(d.size_of_set(2) == 3);
+	REQUIRE(d.size_of_set(3) == 2);
+}
+
 TEST_CASE("dsu with data", "[dsu]") {
 	std::vector<int> v{1, 2, 3, 4, 5};
 	dsu<int, std::multiplies<>> d(v);
@@ -48,6 +75,170 @@ TEST_CASE("dsu with data", "[dsu]") {
 	REQUIRE(d[3] == 20);
 	REQUIRE(d.size_of_set(4) == 2);
 	REQUIRE(d[4] == 20);
+	dsu<int, std::multiplies<>> batched(v);
+	REQUIRE(batched.union_sets_batch({{0, 1}, {1, 2}, {3, 4}, {2, 0}}) == 3);
+	REQUIRE(batched[0] == 6);
+	REQUIRE(batched[4] == 20);
+}
+
+TEST_CASE("dsu with small-to-large containers", "[dsu]") {
+	std::vector<magic_vector<int>> v(5);
+	for (int i = 0; i < 5; i++)
+		v[i].push_back(i);
+	dsu<magic_vector<int>> d(std::move(v));
+	d.union_sets(0, 1);
+	d.union_sets(2, 1);
+	d.union_sets(3, 4);
+	REQUIRE(d[0].size() == 3);
+	REQUIRE(d[4].size() == 2);
+	d.union_sets(4, 0);
+	std::vector<int> all(d[3].begin(), d[3].end());
+	std::ranges::sort(all);
+	REQUIRE(all == std::vector<int>{0, 1, 2, 3, 4});
+}
+
+TEST_CASE("dsu_potential with difference constraints", "[dsu]") {
+	dsu_potential<long long> d(5);
+	REQUIRE(d.union_sets(0, 1, 3) == 1);
+	REQUIRE(d.union_sets(1, 2, -5) == 1);
+	REQUIRE(d.difference(0, 2) == -2);
+	REQUIRE(d.difference(2, 0) == 2);
+	REQUIRE(d.difference(0, 3) == std::nullopt);
+	REQUIRE(d.union_sets(3, 4, 10) == 4);
+	REQUIRE(d.union_sets(4, 0, 1) == 1);
+	REQUIRE(d.difference(3, 2) == 9);
+	REQUIRE(d.union_sets(3, 1, 14) == dsu_potential<long long>::same_set);
+	REQUIRE(d.union_sets(3, 1, 13) == dsu_potential<long long>::contradiction);
+	REQUIRE(d.size_of_set(3) == 5);
+	REQUIRE(d.potential(d.find_set(0)) == 0);
+}
+
+TEST_CASE("dsu_potential with parity constraints", "[dsu]") {
+	dsu_potential<int, std::bit_xor<>, std::identity> d(4);
+	REQUIRE(d.union_sets(0, 1, 1) != d.contradiction);
+	REQUIRE(d.union_sets(1, 2, 1) != d.contradiction);
+	REQUIRE(d.difference(0, 2) == 0);
+	REQUIRE(d.union_sets(2, 3, 0) != d.contradiction);
+	REQUIRE(d.union_sets(0, 3, 1) == d.contradiction);
+	REQUIRE(d.union_sets(0, 3, 0) == d.same_set);
+}
+
+TEST_CASE("dsu_partially_persistent behaves as expected", "[dsu]") {
+	dsu_partially_persistent d(5);
+	REQUIRE(d.union_sets(0, 1) == 1);
+	REQUIRE(d.union_sets(1, 2) == 1);
+	REQUIRE(d.union_sets(3, 4) == 4);
+	REQUIRE(d.union_sets(0, 2) == d.same_set);
+	REQUIRE(d.union_sets(4, 0) == 1);
+	REQUIRE(d.version() == 5);
+	REQUIRE(d.find_set(0, 0) != d.find_set(1, 0));
+	REQUIRE(d.find_set(0, 1) == d.find_set(1, 1));
+	REQUIRE(d.find_set(0, 1) != d.find_set(2, 1));
+	REQUIRE(d.find_set(3, 4) != d.find_set(0, 4));
+	REQUIRE(d.find_set(3) == d.find_set(0));
+	REQUIRE(d.size_of_set(0, 0) == 1);
+	REQUIRE(d.size_of_set(2, 2) == 3);
+	REQUIRE(d.size_of_set(4, 3) == 2);
+	REQUIRE(d.size_of_set(4) == 5);
+}
+
+TEST_CASE("dsu_persistent behaves as expected", "[dsu]") {
+	dsu_persistent d(5);
+	int v1 = d.union_sets(0, 1, 0);
+	int v2 = d.union_sets(1, 2, v1);
+	int v3 = d.union_sets(3, 4, v1);
+	REQUIRE(d.find_set(0, 0) != d.find_set(1, 0));
+	REQUIRE(d.find_set(0, v1) == d.find_set(1, v1));
+	REQUIRE(d.find_set(0, v2) == d.find_set(2, v2));
+	REQUIRE(d.find_set(0, v3) != d.find_set(2, v3));
+	REQUIRE(d.find_set(3, v3) == d.find_set(4, v3));
+	REQUIRE(d.find_set(3, v2) != d.find_set(4, v2));
+	REQUIRE(d.size_of_set(2, v2) == 3);
+	REQUIRE(d.size_of_set(1, v3) == 2);
+	int v4 = d.union_sets(2, 0, v2);
+	REQUIRE(d.size_of_set(0, v4) == 3);
+	REQUIRE(d.version() == v4);
+}
+
+TEST_CASE("persistent dsus over no elements", "[dsu]") {
+	dsu_persistent d(0);
+	REQUIRE(d.size() == 0);
+	REQUIRE(d.version() == 0);
+	dsu_partially_persistent pd(0);
+	REQUIRE(pd.size() == 0);
+	REQUIRE(pd.version() == 0);
+}
+
+TEST_CASE("dsu_persistent agrees with dsu at every version", "[dsu]") {
+	const int n = 30;
+	std::mt19937 rng(3);
+	auto next_rand = [&](unsigned bound) {
+		return static_cast<int>(rng() % bound);
+	};
+	std::vector<std::pair<int, int>> edges;
+	dsu_partially_persistent pd(n);
+	dsu_persistent fd(n);
+	for (int i = 0; i < 40; i++) {
+		edges.emplace_back(next_rand(n), next_rand(n));
+		pd.union_sets(edges[i].first, edges[i].second);
+		fd.union_sets(edges[i].first, edges[i].second, i);
+	}
+	for (int version = 0; version <= 40; version++) {
+		dsu<> d(n);
+		for (int i = 0; i < version; i++)
+			d.union_sets(edges[i].first, edges[i].second);
+		for (int u = 0; u < n; u++) {
+			bool joined = d.find_set(u) == d.find_set(0);
+			REQUIRE((pd.find_set(u, version) == pd.find_set(0, version)) ==
+			        joined);
+			REQUIRE((fd.find_set(u, version) == fd.find_set(0, version)) ==
+			        joined);
+			REQUIRE(pd.size_of_set(u, version) == d.size_of_set(u));
+			REQUIRE(fd.size_of_set(u, version) == d.size_of_set(u));
+		}
+	}
+}
+
+TEST_CASE("concurrent_dsu behaves as expected", "[dsu]") {
+	concurrent_dsu d(5);
+	REQUIRE(d.union_sets(0, 1) == 1);
+	REQUIRE(d.union_sets(1, 2) == 2);
+	REQUIRE(d.union_sets(3, 4) == 4);
+	REQUIRE(d.union_sets(0, 2) == concurrent_dsu::same_set);
+	REQUIRE(d.find_set(0) == 2);
+	REQUIRE(d.find_set(3) == 4);
+	REQUIRE(d.size_of_set(1) == 3);
+	REQUIRE(d.size_of_set(3) == 2);
+}
+
+TEST_CASE("concurrent_dsu agrees with dsu across threads", "[dsu]") {
+	const int n = 20'000, m = 30'000, threads = 4;
+	std::vector<std::pair<int, int>> edges;
+	std::mt19937 rng(7);
+	for (int i = 0; i < m; i++) {
+		int u = rng() % n;
+		edges.emplace_back(u, rng() % n);
+	}
+	concurrent_dsu cd(n);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back([&, t] {
+			for (int i = t; i < m; i += threads)
+				cd.union_sets(edges[i].first, edges[i].second);
+		});
+	}
+	for (auto &w : workers)
+		w.join();
+	dsu<> d(n);
+	d.union_sets_batch(edges);
+	std::vector<int> root_map(n, -1);
+	for (int i = 0; i < n; i++) {
+		int r = d.find_set(i);
+		if (root_map[r] == -1)
+			root_map[r] = cd.find_set(i);
+		REQUIRE(root_map[r] == cd.find_set(i));
+		REQUIRE(d.size_of_set(i) == cd.size_of_set(i));
+	}
 }
 
 TEST_CASE("dsu_rollback behaves as expected", "[dsu]") {
@@ -72,3 +263,154 @@ TEST_CASE("dsu_rollback behaves as expected", "[dsu]") {
 	REQUIRE(d.size_of_set(0) == 3);
 	REQUIRE(d.size_of_set(2) == 1);
 }
+
+TEST_CASE("offline_dynamic_connectivity behaves as expected", "[dsu]") {
+	offline_dynamic_connectivity odc(4);
+	odc.push_edge(0, 1);
+	odc.push_edge(1, 2);
+	odc.push_query(0, 2);
+	odc.erase_edge(2, 1);
+	odc.push_query(0, 2);
+	odc.push_query(0, 1);
+	odc.push_edge(2, 3);
+	odc.push_edge(3, 0);
+	odc.push_query(1, 2);
+	odc.erase_edge(0, 1);
+	odc.push_query(0, 2);
+	odc.push_query(1, 3);
+	REQUIRE(odc.solve() ==
+	        std::vector<bool>{true, false, true, true, true, false});
+}
+
+TEST_CASE("offline_dynamic_connectivity ignores erasing a missing edge",
+          "[dsu]") {
+	offline_dynamic_connectivity odc(3);
+	odc.erase_edge(0, 1);
+	odc.push_edge(0, 1);
+	odc.push_query(0, 1);
+	odc.erase_edge(1, 2);
+	odc.erase_edge(1, 0);
+	odc.erase_edge(0, 1);
+	odc.push_query(0, 1);
+	REQUIRE(odc.solve() == std::vector<bool>{true, false});
+}
+
+TEST_CASE("offline_dynamic_connectivity agrees with recomputation", "[dsu]") {
+	const int n = 8;
+	std::mt19937 rng(99);
+	auto next_rand = [&](unsigned bound) {
+		return static_cast<int>(rng() % bound);
+	};
+	offline_dynamic_connectivity odc(n);
+	std::vector<std::pair<int, int>> edges;
+	std::vector<bool> expected;
+	for (int i = 0; i < 300; i++) {
+		int type = next_rand(3), u = next_rand(n), v = next_rand(n);
+		if (type == 0) {
+			odc.push_edge(u, v);
+			edges.emplace_back(u, v);
+		} else if (type == 1 && !edges.empty()) {
+			int j = next_rand(edges.size());
+			odc.erase_edge(edges[j].first, edges[j].second);
+			edges.erase(edges.begin() + j);
+		} else {
+			odc.push_query(u, v);
+			dsu<> d(n);
+			d.union_sets_batch(edges);
+			expected.push_back(d.find_set(u) == d.find_set(v));
+		}
+	}
+	REQUIRE(odc.solve() == expected);
+}
+
+TEST_CASE("dsu random unions benchmark", "[dsu][.][benchmark]") {
+	const int n = 30'000, m = 200'000;
+	std::vector<std::pair<int, int>> edges;
+	std::mt19937 rng(0);
+	for (int i = 0; i < m; i++) {
+		int u = rng() % n;
+		edges.emplace_back(u, rng() % n);
+	}
+	BENCHMARK("union_sets") {
+		dsu<> d(n);
+		int merged = 0;
+		for (auto [u, v] : edges)
+			merged += d.union_sets(u, v) != d.same_set;
+		return merged;
+	};
+	BENCHMARK("union_sets_batch") {
+		dsu<> d(n);
+		return d.union_sets_batch(edges);
+	};
+	BENCHMARK("union_sets_batch with 16-bit storage") {
+		dsu<void, std::plus<>, int16_t> d(n);
+		return d.union_sets_batch(edges);
+	};
+}
+
+// the recursive find_set that dsu used before path halving, as a baseline
+struct recursive_dsu : std::vector<int> {
+	explicit recursive_dsu(size_t n) : std::vector<int>(n, -1) {}
+	int find_set(int x) {
+		return (*this)[x] >= 0 ? (*this)[x] = find_set((*this)[x]) : x;
+	}
+	int union_sets(int u, int v) {
+		int gu = find_set(u), gv = find_set(v);
+		if (gu == gv)
+			return -1;
+		if ((*this)[gu] < (*this)[gv])
+			std::swap(gu, gv);
+		(*this)[gv] += (*this)[gu];
+		(*this)[gu] = gv;
+		return gv;
+	}
+};
+
+TEST_CASE("dsu path halving against recursive find_set",
+          "[dsu][.][benchmark]") {
+	const int n = 1'000'000, m = 10'000'000;
+	std::vector<std::pair<int, int>> edges;
+	std::mt19937 rng(0);
+	for (int i = 0; i < m; i++) {
+		int u = rng() % n;
+		edges.emplace_back(u, rng() % n);
+	}
+	BENCHMARK("recursive find_set") {
+		recursive_dsu d(n);
+		int merged = 0;
+		for (auto [u, v] : edges)
+			merged += d.union_sets(u, v) != -1;
+		return merged;
+	};
+	BENCHMARK("path halving find_set") {
+		dsu<> d(n);
+		return d.union_sets_batch(edges);
+	};
+}
+
+TEST_CASE("concurrent_dsu multi-threaded benchmark", "[dsu][.][benchmark]") {
+	const int n = 200'000, m = 400'000, threads = 4;
+	std::vector<std::pair<int, int>> edges;
+	std::mt19937 rng(0);
+	for (int i = 0; i < m; i++) {
+		int u = rng() % n;
+		edges.emplace_back(u, rng() % n);
+	}
+	BENCHMARK("dsu single thread") {
+		dsu<> d(n);
+		return d.union_sets_batch(edges);
+	};
+	BENCHMARK("concurrent_dsu 4 threads") {
+		concurrent_dsu d(n);
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; t++) {
+			workers.emplace_back([&, t] {
+				for (int i = t; i < m; i += threads)
+					d.union_sets(edges[i].first, edges[i].second);
+			});
+		}
+		for (auto &w : workers)
+			w.join();
+		return d.size_of_set(0);
+	};
+}
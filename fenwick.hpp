@@ -6,33 +6,351 @@
 #ifndef FENWICK_HPP
 #define FENWICK_HPP
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <functional>
 #include <vector>
 
-template <class T> class fenwick {
+#include "functional.hpp"
+#include "utilities.hpp"
+
+/**
+ * Operations a fenwick tree accepts. Besides the traits in functional.hpp,
+ * std::plus<> over any default constructible T falls back to T{} as zero and
+ * unary minus as inverse, so sums of std::complex or user structs still work.
+ * Segment trees get no such fallback, T{} is not neutral for every combine.
+ */
+template <class Op, class T>
+concept fenwick_monoid =
+    fn::monoid<Op, T> ||
+    (std::same_as<Op, std::plus<>> && fn::semigroup<Op, T> &&
+     std::default_initializable<T>);
+
+template <class Op, class T>
+concept fenwick_group =
+    fn::group<Op, T> ||
+    (std::same_as<Op, std::plus<>> && fenwick_monoid<Op, T> &&
+     requires(const T &x) {
+	     { -x } -> std::convertible_to<T>;
+     });
+
+template <class Op, class T>
+    requires fenwick_monoid<Op, T>
+constexpr T fenwick_identity() {
+	if constexpr (fn::monoid<Op, T>)
+		return fn::identity_element<Op, T>::value();
+	else
+		return T{};
+}
+
+template <class Op, class T>
+    requires fenwick_group<Op, T>
+constexpr T fenwick_inverse(const T &x) {
+	if constexpr (fn::group<Op, T>)
+		return fn::inverse_element<Op, T>::value(x);
+	else
+		return -x;
+}
+
+/**
+ * Prefix queries work for any commutative monoid, range queries additionally
+ * need the operation to be a group so the prefix before l can be inverted.
+ *
+ * Updates and queries visit nodes a power of two apart, which on huge arrays
+ * fall into the same cache sets. A non-zero HoleShift leaves an unused slot
+ * after every 2^HoleShift nodes so that these strides are broken up.
+ */
+template <class T, class Op = std::plus<>, size_t HoleShift = 0>
+    requires fenwick_monoid<Op, T>
+class fenwick {
+	size_t n;
 	std::vector<T> ft;
+	Op op;
+	static constexpr size_t slot(size_t idx) {
+		if constexpr (HoleShift == 0)
+			return idx;
+		else
+			return idx + (idx >> HoleShift);
+	}
 	T _query(size_t idx) const {
-		T sum{};
+		T sum = fenwick_identity<Op, T>();
 		for (; idx > 0; idx -= idx & (~idx + 1))
-			sum += ft[idx - 1];
+			sum = op(sum, ft[slot(idx - 1)]);
 		return sum;
 	}
 	void _modify(size_t idx, const T &val) {
-		for (; idx <= ft.size(); idx += idx & (~idx + 1))
-			ft[idx - 1] += val;
+		for (; idx <= n; idx += idx & (~idx + 1))
+			ft[slot(idx - 1)] = op(ft[slot(idx - 1)], val);
 	}
 
   public:
-	explicit fenwick(size_t n) : ft(n) {}
-	explicit fenwick(const std::vector<T> &v) : fenwick(v.size()) {
-		for (size_t i = 0; i < v.size(); ++i)
-			modify(i, v[i]);
+	explicit fenwick(size_t n, Op op = {})
+	    : n(n), ft(slot(n), fenwick_identity<Op, T>()), op(op) {}
+	// linear build, every node pushes its total to its parent once
+	explicit fenwick(const std::vector<T> &v, Op op = {})
+	    : fenwick(v.size(), op) {
+		for (size_t i = 0; i < n; ++i)
+			ft[slot(i)] = v[i];
+		for (size_t idx = 1; idx <= n; ++idx) {
+			size_t parent = idx + (idx & (~idx + 1));
+			if (parent <= n)
+				ft[slot(parent - 1)] =
+				    op(ft[slot(parent - 1)], ft[slot(idx - 1)]);
+		}
 	}
+	size_t size() const { return n; }
 	void modify(size_t idx, const T &val) { _modify(idx + 1, val); }
 	T query(size_t idx) const { return _query(idx + 1); }
-	T query(size_t l, size_t r) const {
+	T query(size_t l, size_t r) const
+	    requires fenwick_group<Op, T>
+	{
 		if (l == 0)
 			return query(r);
-		return query(r) - query(l - 1);
+		return op(query(r), fenwick_inverse<Op, T>(query(l - 1)));
+	}
+
+	/**
+	 * Smallest idx such that query(idx) >= val, or size() if there is none.
+	 * Prefixes must be non-decreasing, e.g. sums of non-negative values.
+	 */
+	size_t lower_bound(const T &val) const
+	    requires std::totally_ordered<T>
+	{
+		size_t pos = 0;
+		T sum = fenwick_identity<Op, T>();
+		for (size_t step = std::bit_floor(n); step; step >>= 1) {
+			if (pos + step <= n) {
+				T next = op(sum, ft[slot(pos + step - 1)]);
+				if (next < val)
+					pos += step, sum = next;
+			}
+		}
+		return pos;
+	}
+};
+
+// fenwick with a hole every 1024 nodes, for arrays far beyond the cache size
+template <class T, class Op = std::plus<>>
+using spaced_fenwick = fenwick<T, Op, 10>;
+
+/**
+ * Range update and point query, a fenwick tree over the differences of
+ * adjacent elements.
+ */
+template <class T, class Op = std::plus<>>
+    requires fenwick_group<Op, T>
+class range_update_fenwick {
+	fenwick<T, Op> diff;
+	Op op;
+
+	static std::vector<T> differences(const std::vector<T> &v, Op op) {
+		std::vector<T> d(v);
+		for (size_t i = 1; i < v.size(); ++i)
+			d[i] = op(v[i], fenwick_inverse<Op, T>(v[i - 1]));
+		return d;
+	}
+
+  public:
+	explicit range_update_fenwick(size_t n, Op op = {}) : diff(n, op), op(op) {}
+	explicit range_update_fenwick(const std::vector<T> &v, Op op = {})
+	    : diff(differences(v, op), op), op(op) {}
+	size_t size() const { return diff.size(); }
+	void modify(size_t l, size_t r, const T &val) {
+		diff.modify(l, val);
+		if (r + 1 < diff.size())
+			diff.modify(r + 1, fenwick_inverse<Op, T>(val));
+	}
+	T query(size_t idx) const { return diff.query(idx); }
+};
+
+/**
+ * Range add and range sum with two fenwick trees, one over the differences d
+ * and one over i * d[i], since the prefix sum up to i equals
+ * (i + 1) * sum(d[0..i]) - sum(j * d[j] for j in 0..i).
+ */
+template <class T>
+    requires fenwick_group<std::plus<>, T>
+class range_add_fenwick {
+	fenwick<T> diff, weighted;
+
+	static std::vector<T> differences(const std::vector<T> &v) {
+		std::vector<T> d(v);
+		for (size_t i = 1; i < v.size(); ++i)
+			d[i] = v[i] - v[i - 1];
+		return d;
+	}
+	static std::vector<T> weigh(std::vector<T> d) {
+		for (size_t i = 0; i < d.size(); ++i)
+			d[i] = d[i] * T(i);
+		return d;
+	}
+
+	T prefix(size_t idx) const {
+		return diff.query(idx) * T(idx + 1) - weighted.query(idx);
+	}
+
+  public:
+	explicit range_add_fenwick(size_t n) : diff(n), weighted(n) {}
+	explicit range_add_fenwick(const std::vector<T> &v)
+	    : diff(differences(v)), weighted(weigh(differences(v))) {}
+	size_t size() const { return diff.size(); }
+	void modify(size_t l, size_t r, const T &val) {
+		diff.modify(l, val);
+		weighted.modify(l, val * T(l));
+		if (r + 1 < diff.size()) {
+			diff.modify(r + 1, -val);
+			weighted.modify(r + 1, -(val * T(r + 1)));
+		}
+	}
+	T query(size_t idx) const { return query(idx, idx); }
+	T query(size_t l, size_t r) const {
+		return l == 0 ? prefix(r) : prefix(r) - prefix(l - 1);
+	}
+};
+
+/**
+ * N-dimensional fenwick tree in one flat allocation, the last dimension is
+ * contiguous. Prefix queries work for any commutative monoid, box queries
+ * use inclusion-exclusion over the 2^N corners and need a group.
+ */
+template <class T, size_t N, class Op = std::plus<>>
+    requires(N > 0) && fenwick_monoid<Op, T>
+class fenwick_nd {
+	std::array<size_t, N> dims, strides;
+	std::vector<T> ft;
+	Op op;
+
+	template <size_t D>
+	void _modify(size_t offset, const std::array<size_t, N> &idx,
+	             const T &val) {
+		for (size_t i = idx[D] + 1; i <= dims[D]; i += i & (~i + 1)) {
+			size_t o = offset + (i - 1) * strides[D];
+			if constexpr (D + 1 == N)
+				ft[o] = op(ft[o], val);
+			else
+				_modify<D + 1>(o, idx, val);
+		}
+	}
+	template <size_t D>
+	T _query(size_t offset, const std::array<size_t, N> &idx) const {
+		T sum = fenwick_identity<Op, T>();
+		for (size_t i = idx[D] + 1; i > 0; i -= i & (~i + 1)) {
+			size_t o = offset + (i - 1) * strides[D];
+			if constexpr (D + 1 == N)
+				sum = op(sum, ft[o]);
+			else
+				sum = op(sum, _query<D + 1>(o, idx));
+		}
+		return sum;
+	}
+
+  public:
+	explicit fenwick_nd(const std::array<size_t, N> &dims, Op op = {})
+	    : dims(dims), op(op) {
+		size_t total = 1;
+		for (size_t d = N; d-- > 0;)
+			strides[d] = total, total *= dims[d];
+		ft.assign(total, fenwick_identity<Op, T>());
+	}
+	const std::array<size_t, N> &size() const { return dims; }
+	void modify(const std::array<size_t, N> &idx, const T &val) {
+		_modify<0>(0, idx, val);
+	}
+	// combination over the box from the origin to idx, inclusive
+	T query(const std::array<size_t, N> &idx) const {
+		return _query<0>(0, idx);
+	}
+	// combination over the box [lo, hi], inclusive in every dimension
+	T query(const std::array<size_t, N> &lo,
+	        const std::array<size_t, N> &hi) const
+	    requires fenwick_group<Op, T>
+	{
+		T sum = fenwick_identity<Op, T>();
+		for (size_t mask = 0; mask < (size_t{1} << N); mask++) {
+			std::array<size_t, N> corner = hi;
+			bool empty = false, odd = false;
+			for (size_t d = 0; d < N; d++) {
+				if (mask >> d & 1) {
+					empty |= lo[d] == 0;
+					corner[d] = lo[d] - 1, odd = !odd;
+				}
+			}
+			if (empty)
+				continue;
+			T part = query(corner);
+			sum = op(sum, odd ? fenwick_inverse<Op, T>(part) : part);
+		}
+		return sum;
+	}
+};
+
+/**
+ * Offline weighted point counting in axis-parallel rectangles. Queries are
+ * answered by sweeping over x with a fenwick tree over the compressed y
+ * coordinates, in O((n + q) log n) time and O(n + q) memory.
+ */
+template <class Coord = long long, class T = long long>
+class offline_rectangle_count {
+	struct point {
+		Coord x, y;
+		T weight;
+	};
+	struct event {
+		Coord x;
+		bool inclusive;
+		size_t id;
+	};
+	struct rectangle {
+		Coord ly, ry;
+	};
+	// each query is the difference of two prefixes over x, one excluding lx
+	// and one including rx
+	std::vector<point> points;
+	std::vector<rectangle> queries;
+	std::vector<event> events;
+
+  public:
+	void add_point(const Coord &x, const Coord &y, const T &weight = T(1)) {
+		points.push_back({x, y, weight});
+	}
+	// registers the query for [lx, rx] x [ly, ry] and returns its id
+	size_t add_query(const Coord &lx, const Coord &ly, const Coord &rx,
+	                 const Coord &ry) {
+		queries.push_back({ly, ry});
+		events.push_back({lx, false, queries.size() - 1});
+		events.push_back({rx, true, queries.size() - 1});
+		return queries.size() - 1;
+	}
+	// total weight inside each query, in the order they were added
+	std::vector<T> solve() {
+		compression_vector<Coord> ys(points.size());
+		for (size_t i = 0; i < points.size(); i++)
+			ys[i] = points[i].y;
+		ys.compress();
+		std::ranges::sort(points, {}, &point::x);
+		// a prefix excluding x comes before the one including it
+		std::ranges::sort(events, [](const event &a, const event &b) {
+			return a.x < b.x || (!(b.x < a.x) && !a.inclusive && b.inclusive);
+		});
+		fenwick<T> ft(ys.size());
+		std::vector<T> res(queries.size());
+		size_t p = 0;
+		auto covers = [](const event &e, const Coord &x) {
+			return x < e.x || (e.inclusive && !(e.x < x));
+		};
+		for (const auto &e : events) {
+			for (; p < points.size() && covers(e, points[p].x); p++)
+				ft.modify(ys.lower_bound_index(points[p].y), points[p].weight);
+			size_t lo = ys.lower_bound_index(queries[e.id].ly);
+			size_t hi = ys.upper_bound_index(queries[e.id].ry);
+			if (lo < hi) {
+				T part = ft.query(lo, hi - 1);
+				res[e.id] = e.inclusive ? res[e.id] + part : res[e.id] - part;
+			}
+		}
+		return res;
 	}
 };
 
@@ -1,8 +1,20 @@
 #include "fenwick.hpp"
 #include "modint.hpp"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
 TEST_CASE("fenwick behaves as expected", "[fenwick]") {
 	SECTION("fenwick constructed as expected") {
 		fenwick<int> f(5);
@@ -35,3 +47,282 @@ TEST_CASE("fenwick with custom datatype", "[fenwick]") {
 	REQUIRE(f.query(0, 4) == 0);
 	REQUIRE(g_tree.query(0, 3) == -12);
 }
+
+TEST_CASE("fenwick sums types without identity traits", "[fenwick]") {
+	using cd = std::complex<double>;
+	std::vector<cd> v{{1, 2}, {3, -1}, {0, 4}, {-2, 0}};
+	fenwick f(v);
+	REQUIRE(f.query(3) == cd(2, 5));
+	REQUIRE(f.query(1, 2) == cd(3, 3));
+	f.modify(2, {1, 1});
+	REQUIRE(f.query(2, 3) == cd(-1, 5));
+
+	range_update_fenwick<cd> g(v);
+	g.modify(1, 2, {0, 1});
+	REQUIRE(g.query(0) == cd(1, 2));
+	REQUIRE(g.query(2) == cd(0, 5));
+	REQUIRE(g.query(3) == cd(-2, 0));
+
+	range_add_fenwick<cd> h(v);
+	h.modify(0, 1, {1, 0});
+	REQUIRE(h.query(0, 3) == cd(4, 5));
+}
+
+TEST_CASE("fenwick with other monoids", "[fenwick]") {
+	SECTION("prefix maximum") {
+		std::vector<int> v{3, 2, 8, 5};
+		fenwick<int, fn::maximum<>> f(v);
+		REQUIRE(f.query(1) == 3);
+		REQUIRE(f.query(3) == 8);
+		f.modify(0, 10);
+		REQUIRE(f.query(0) == 10);
+		REQUIRE(f.query(3) == 10);
+	}
+	SECTION("range xor") {
+		std::vector<unsigned> v{3, 2, 8, 5};
+		fenwick<unsigned, std::bit_xor<>> f(v);
+		REQUIRE(f.query(1, 2) == 10);
+		REQUIRE(f.query(0, 3) == 12);
+		f.modify(2, 8);
+		REQUIRE(f.query(1, 3) == 7);
+	}
+}
+
+TEST_CASE("fenwick linear build matches repeated modify", "[fenwick]") {
+	std::vector<long long> v(1'000);
+	std::mt19937 rng(1);
+	for (auto &x : v)
+		x = rng() % 1'000;
+	fenwick<long long> built(v), inserted(v.size());
+	fenwick<long long, fn::maximum<>> built_max(v);
+	for (size_t i = 0; i < v.size(); i++)
+		inserted.modify(i, v[i]);
+	for (size_t i = 0; i < v.size(); i++) {
+		REQUIRE(built.query(i) == inserted.query(i));
+		REQUIRE(built_max.query(i) ==
+		        *std::max_element(v.begin(), v.begin() + i + 1));
+	}
+}
+
+TEST_CASE("fenwick lower_bound", "[fenwick]") {
+	std::vector<int> v{3, 0, 2, 5, 0, 1};
+	fenwick<int> f(v);
+	REQUIRE(f.lower_bound(0) == 0);
+	REQUIRE(f.lower_bound(3) == 0);
+	REQUIRE(f.lower_bound(4) == 2);
+	REQUIRE(f.lower_bound(5) == 2);
+	REQUIRE(f.lower_bound(10) == 3);
+	REQUIRE(f.lower_bound(11) == 5);
+	REQUIRE(f.lower_bound(12) == 6);
+	SECTION("k-th smallest of a multiset") {
+		fenwick<int> count(10);
+		for (int x : {7, 2, 2, 9, 4})
+			count.modify(x, 1);
+		REQUIRE(count.lower_bound(1) == 2);
+		REQUIRE(count.lower_bound(2) == 2);
+		REQUIRE(count.lower_bound(3) == 4);
+		REQUIRE(count.lower_bound(5) == 9);
+	}
+}
+
+TEST_CASE("fenwick range update variants", "[fenwick]") {
+	std::vector<long long> v{3, 2, 4, 5, 1};
+	SECTION("range update, point query") {
+		range_update_fenwick<long long> f(v);
+		REQUIRE(f.query(3) == 5);
+		f.modify(1, 3, 10);
+		REQUIRE(f.query(0) == 3);
+		REQUIRE(f.query(1) == 12);
+		REQUIRE(f.query(3) == 15);
+		REQUIRE(f.query(4) == 1);
+		f.modify(2, 4, -1);
+		REQUIRE(f.query(4) == 0);
+	}
+	SECTION("range xor update, point query") {
+		range_update_fenwick<unsigned, std::bit_xor<>> f(5);
+		f.modify(0, 2, 6);
+		f.modify(1, 4, 3);
+		REQUIRE(f.query(0) == 6);
+		REQUIRE(f.query(2) == 5);
+		REQUIRE(f.query(4) == 3);
+	}
+	SECTION("range add, range sum") {
+		range_add_fenwick<long long> f(v);
+		REQUIRE(f.query(0, 4) == 15);
+		f.modify(1, 3, 10);
+		REQUIRE(f.query(0, 4) == 45);
+		REQUIRE(f.query(2, 2) == 14);
+		REQUIRE(f.query(3, 4) == 16);
+		f.modify(0, 4, -1);
+		REQUIRE(f.query(0, 4) == 40);
+		REQUIRE(f.query(4) == 0);
+	}
+	SECTION("range add, range sum on modint") {
+		range_add_fenwick<mint_1097> f(4);
+		f.modify(0, 3, -2);
+		f.modify(1, 2, 5);
+		REQUIRE(f.query(0, 3) == 2);
+		REQUIRE(f.query(1, 1) == 3);
+	}
+}
+
+TEST_CASE("fenwick range add matches brute force", "[fenwick]") {
+	std::mt19937 rng(3);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	const int n = 37;
+	std::vector<long long> v(n);
+	range_add_fenwick<long long> f(n);
+	range_update_fenwick<long long> g(n);
+	for (int it = 0; it < 2'000; it++) {
+		size_t l = rnd(n), r = rnd(n);
+		if (l > r)
+			std::swap(l, r);
+		if (it % 2) {
+			long long val = (long long)rnd(100) - 50;
+			f.modify(l, r, val);
+			g.modify(l, r, val);
+			for (size_t i = l; i <= r; i++)
+				v[i] += val;
+		} else {
+			REQUIRE(f.query(l, r) ==
+			        std::accumulate(v.begin() + l, v.begin() + r + 1, 0LL));
+			REQUIRE(g.query(l) == v[l]);
+		}
+	}
+}
+
+TEST_CASE("fenwick build benchmark", "[fenwick][.][benchmark]") {
+	std::vector<long long> v(1 << 20);
+	std::iota(v.begin(), v.end(), 0);
+	BENCHMARK("linear build") { return fenwick<long long>(v).query(1000); };
+	BENCHMARK("repeated modify") {
+		fenwick<long long> f(v.size());
+		for (size_t i = 0; i < v.size(); i++)
+			f.modify(i, v[i]);
+		return f.query(1000);
+	};
+}
+
+TEST_CASE("spaced_fenwick matches fenwick", "[fenwick]") {
+	std::mt19937 rng(6);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	const size_t n = 5'000;
+	std::vector<long long> v(n);
+	for (auto &x : v)
+		x = rnd(100);
+	fenwick<long long> f(v);
+	spaced_fenwick<long long> g(v);
+	fenwick<long long, std::plus<>, 3> h(v);
+	for (int it = 0; it < 2'000; it++) {
+		size_t p = rnd(n);
+		long long val = rnd(100);
+		f.modify(p, val), g.modify(p, val), h.modify(p, val);
+		size_t l = rnd(n), r = rnd(n);
+		if (l > r)
+			std::swap(l, r);
+		REQUIRE(g.query(l, r) == f.query(l, r));
+		REQUIRE(h.query(l, r) == f.query(l, r));
+		long long k = rnd(n * 100);
+		REQUIRE(g.lower_bound(k) == f.lower_bound(k));
+		REQUIRE(h.lower_bound(k) == f.lower_bound(k));
+	}
+}
+
+TEST_CASE("fenwick layout benchmark", "[fenwick][.][benchmark]") {
+	const int q = 1 << 14;
+	for (size_t n : {size_t{1} << 16, size_t{1} << 20, size_t{1} << 22}) {
+		std::vector<size_t> positions(q);
+		std::mt19937 rng(2);
+		for (auto &p : positions)
+			p = rng() % n;
+		auto sweep = [&](auto &f, const std::string &name) {
+			BENCHMARK(name + " modify, n = " + std::to_string(n)) {
+				for (size_t p : positions)
+					f.modify(p, 1);
+				return f.query(n - 1);
+			};
+			BENCHMARK(name + " query, n = " + std::to_string(n)) {
+				long long res = 0;
+				for (size_t p : positions)
+					res += f.query(p);
+				return res;
+			};
+		};
+		fenwick<int> contiguous(n);
+		spaced_fenwick<int> spaced(n);
+		sweep(contiguous, "fenwick");
+		sweep(spaced, "spaced_fenwick");
+	}
+}
+
+TEST_CASE("fenwick_nd behaves as expected", "[fenwick]") {
+	SECTION("2d prefix and box sums") {
+		fenwick_nd<int, 2> f({3, 4});
+		f.modify({0, 0}, 1);
+		f.modify({1, 2}, 5);
+		f.modify({2, 3}, 2);
+		REQUIRE(f.query({1, 2}) == 6);
+		REQUIRE(f.query({2, 3}) == 8);
+		REQUIRE(f.query({1, 1}, {2, 3}) == 7);
+		REQUIRE(f.query({2, 0}, {2, 2}) == 0);
+	}
+	SECTION("3d matches brute force") {
+		const size_t n = 5;
+		fenwick_nd<long long, 3> f({n, n, n});
+		std::vector<long long> a(n * n * n);
+		std::mt19937 rng(9);
+		auto rnd = [&](unsigned bound) { return rng() % bound; };
+		for (int it = 0; it < 500; it++) {
+			std::array<size_t, 3> p{rnd(n), rnd(n), rnd(n)};
+			long long val = (long long)rnd(100) - 50;
+			f.modify(p, val);
+			a[(p[0] * n + p[1]) * n + p[2]] += val;
+			std::array<size_t, 3> lo{rnd(n), rnd(n), rnd(n)}, hi = lo;
+			for (auto &x : hi)
+				x += rnd(n - x);
+			long long sum = 0;
+			for (size_t i = lo[0]; i <= hi[0]; i++)
+				for (size_t j = lo[1]; j <= hi[1]; j++)
+					for (size_t k = lo[2]; k <= hi[2]; k++)
+						sum += a[(i * n + j) * n + k];
+			REQUIRE(f.query(lo, hi) == sum);
+		}
+	}
+	SECTION("2d prefix maximum") {
+		fenwick_nd<int, 2, fn::maximum<>> f({4, 4});
+		f.modify({1, 2}, 7);
+		f.modify({3, 0}, 4);
+		REQUIRE(f.query({0, 3}) == std::numeric_limits<int>::lowest());
+		REQUIRE(f.query({3, 1}) == 4);
+		REQUIRE(f.query({3, 3}) == 7);
+	}
+}
+
+TEST_CASE("offline_rectangle_count matches brute force", "[fenwick]") {
+	std::mt19937 rng(4);
+	auto rnd = [&](unsigned bound) {
+		return (long long)(rng() % bound) - bound / 2;
+	};
+	std::vector<std::tuple<long long, long long, long long>> points(300);
+	offline_rectangle_count<long long> counter;
+	for (auto &[x, y, w] : points) {
+		x = rnd(40), y = rnd(1'000'000'000), w = rnd(10) + 5;
+		counter.add_point(x, y, w);
+	}
+	std::vector<long long> expected;
+	for (int i = 0; i < 300; i++) {
+		long long lx = rnd(40), rx = rnd(40);
+		long long ly = rnd(1'000'000'000), ry = rnd(1'000'000'000);
+		if (lx > rx)
+			std::swap(lx, rx);
+		if (ly > ry)
+			std::swap(ly, ry);
+		REQUIRE(counter.add_query(lx, ly, rx, ry) == size_t(i));
+		long long sum = 0;
+		for (auto [x, y, w] : points)
+			if (lx <= x && x <= rx && ly <= y && y <= ry)
+				sum += w;
+		expected.push_back(sum);
+	}
+	REQUIRE(counter.solve() == expected);
+}
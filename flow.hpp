@@ -6,6 +6,13 @@
 #ifndef FLOW_HPP
 #define FLOW_HPP
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <type_traits>
 #include <vector>
 
 #include "graph.hpp"
@@ -100,6 +107,143 @@ template <class T> class flow_net {
 	}
 };
 
+/**
+ * Hopcroft-Karp maximum bipartite matching. Nodes [0, n_left) of the graph
+ * are the left part and the remaining nodes are the right part, with edges
+ * directed from left to right.
+ */
+class bipartite_matching {
+	int n_left, n_right;
+	std::vector<int> start, adj;
+	std::vector<int> match_left, match_right;
+
+  public:
+	static constexpr int inf = cp_limits<int>::infinity();
+	static constexpr int unmatched = -1;
+
+	bipartite_matching(const graph<void> &g, int n_left)
+	    : n_left(n_left), n_right(std::ssize(g) - n_left), start(n_left + 1),
+	      match_left(n_left, unmatched), match_right(n_right, unmatched) {
+		for (int u = 0; u < n_left; u++)
+			start[u + 1] = start[u] + std::ssize(g[u]);
+		adj.reserve(start[n_left]);
+		for (int u = 0; u < n_left; u++) {
+			for (int v : g[u])
+				adj.push_back(v - n_left);
+		}
+	}
+
+	int max_matching() {
+		int matched = 0;
+		// greedy initial matching
+		for (int u = 0; u < n_left; u++) {
+			for (int i = start[u]; i < start[u + 1]; i++) {
+				if (match_left[u] != unmatched)
+					break;
+				if (match_right[adj[i]] == unmatched) {
+					match_left[u] = adj[i];
+					match_right[adj[i]] = u;
+				}
+			}
+		}
+		std::vector<int> distance(n_left), current(n_left), q(n_left);
+		auto bfs = [&]() {
+			int head = 0, tail = 0;
+			bool found = false;
+			for (int u = 0; u < n_left; u++) {
+				distance[u] = match_left[u] == unmatched ? 0 : inf;
+				if (distance[u] == 0)
+					q[tail++] = u;
+			}
+			while (head < tail) {
+				int u = q[head++];
+				for (int i = start[u]; i < start[u + 1]; i++) {
+					int w = match_right[adj[i]];
+					if (w == unmatched) {
+						found = true;
+					} else if (distance[w] == inf) {
+						distance[w] = distance[u] + 1;
+						q[tail++] = w;
+					}
+				}
+			}
+			return found;
+		};
+		auto dfs = [&](auto &self, int u) -> bool {
+			for (int &i = current[u]; i < start[u + 1]; i++) {
+				int v = adj[i], w = match_right[v];
+				if (w == unmatched ||
+				    (distance[w] == distance[u] + 1 && self(self, w))) {
+					match_left[u] = v;
+					match_right[v] = u;
+					return true;
+				}
+			}
+			distance[u] = inf;
+			return false;
+		};
+		while (bfs()) {
+			std::copy(start.begin(), start.end() - 1, current.begin());
+			for (int u = 0; u < n_left; u++) {
+				if (match_left[u] == unmatched)
+					dfs(dfs, u);
+			}
+		}
+		for (int u = 0; u < n_left; u++)
+			matched += match_left[u] != unmatched;
+		return matched;
+	}
+
+	// matched node of u in graph numbering, or unmatched
+	int get_match(int u) const {
+		if (u < n_left)
+			return match_left[u] == unmatched ? unmatched
+			                                  : match_left[u] + n_left;
+		return match_right[u - n_left];
+	}
+
+	std::vector<std::pair<int, int>> matching() const {
+		std::vector<std::pair<int, int>> result;
+		for (int u = 0; u < n_left; u++) {
+			if (match_left[u] != unmatched)
+				result.emplace_back(u, match_left[u] + n_left);
+		}
+		return result;
+	}
+
+	// minimum vertex cover by Konig's theorem, valid after max_matching
+	std::vector<int> min_vertex_cover() const {
+		std::vector<int> visited_left(n_left), visited_right(n_right), q;
+		for (int u = 0; u < n_left; u++) {
+			if (match_left[u] == unmatched) {
+				visited_left[u] = true;
+				q.push_back(u);
+			}
+		}
+		for (size_t head = 0; head < q.size(); head++) {
+			int u = q[head];
+			for (int i = start[u]; i < start[u + 1]; i++) {
+				int v = adj[i], w = match_right[v];
+				visited_right[v] = true;
+				if (w != unmatched && !visited_left[w]) {
+					visited_left[w] = true;
+					q.push_back(w);
+				}
+			}
+		}
+		std::vector<int> cover;
+		for (int u = 0; u < n_left; u++) {
+			if (!visited_left[u])
+				cover.push_back(u);
+		}
+		for (int v = 0; v < n_right; v++) {
+			if (visited_right[v])
+				cover.push_back(v + n_left);
+		}
+		return cover;
+	}
+};
+
 template <class T> class cost_flow_net {
   private:
 	struct edge {
@@ -108,13 +252,262 @@ template <class T> class cost_flow_net {
 	int n;
 	graph<int> g;
 	std::vector<edge> edges;
+	std::vector<T> supply;
+	T lower_cost = 0;
 	int source, sink;
+	// SPFA queue flags, all zero whenever the queue is empty, so they are
+	// kept across calls instead of being reallocated
+	std::vector<int> in_queue;
+
+	// artificial arcs cost (max |cost| + 1) * (n + 1) and potentials reach
+	// about twice that, so narrow integral costs are widened in the simplex
+	using simplex_cost =
+	    std::conditional_t<std::is_integral_v<T> &&
+	                           sizeof(T) < sizeof(long long),
+	                       long long, T>;
+
+	// primal network simplex with block search pivoting over the residual
+	// network given by to/cost/res, where arcs e and e ^ 1 are paired; the
+	// excess of each node is routed through artificial arcs to an extra root
+	bool network_simplex(std::vector<int> &to,
+	                     std::vector<simplex_cost> &cost, std::vector<T> &res,
+	                     const std::vector<T> &excess) {
+		const int root = n, m = to.size();
+		simplex_cost max_cost = 0;
+		for (simplex_cost c : cost)
+			max_cost = std::max(max_cost, c < 0 ? -c : c);
+		assert(!std::is_integral_v<simplex_cost> ||
+		       max_cost <
+		           std::numeric_limits<simplex_cost>::max() / 4 / (n + 1));
+		const simplex_cost art_cost = (max_cost + 1) * (n + 1);
+		// spanning tree rooted at root, parent_edge[u] is oriented parent -> u
+		std::vector<int> parent(n + 1, graph<int>::no_parent),
+		    parent_edge(n + 1, -1);
+		for (int u = 0; u < n; u++) {
+			bool outgoing = excess[u] >= 0;
+			T amount = outgoing ? excess[u] : -excess[u];
+			parent[u] = root;
+			parent_edge[u] = to.size() + outgoing;
+			to.push_back(outgoing ? root : u);
+			to.push_back(outgoing ? u : root);
+			cost.push_back(art_cost);
+			cost.push_back(-art_cost);
+			res.push_back(cp_limits<T>::infinity() - amount);
+			res.push_back(amount);
+		}
+		// potentials are evaluated lazily and invalidated after each pivot
+		std::vector<simplex_cost> potential(n + 1);
+		std::vector<int> stamp(n + 1), mark(n + 1), path;
+		int now = 1, mark_id = 0;
+		stamp[root] = now;
+		auto get_potential = [&](int u) {
+			for (int v = u; stamp[v] != now; v = parent[v])
+				path.push_back(v);
+			for (; !path.empty(); path.pop_back()) {
+				int v = path.back();
+				potential[v] = potential[parent[v]] + cost[parent_edge[v]];
+				stamp[v] = now;
+			}
+			return potential[u];
+		};
+		const int total = to.size();
+		const int block = std::max(static_cast<int>(std::sqrt(total)), 10);
+		for (int next = 0;;) {
+			int entering = -1;
+			simplex_cost best = 0;
+			for (int scanned = 0, count = 0; scanned < total; scanned++) {
+				int e = next;
+				next = next + 1 == total ? 0 : next + 1;
+				if (res[e] > 0) {
+					simplex_cost reduced = cost[e] + get_potential(to[e ^ 1]) -
+					                       get_potential(to[e]);
+					if (reduced < best)
+						best = reduced, entering = e;
+				}
+				if (++count == block) {
+					if (entering != -1)
+						break;
+					count = 0;
+				}
+			}
+			if (entering == -1)
+				break;
+			// the cycle is join -> ... -> a -> b -> ... -> join
+			int a = to[entering ^ 1], b = to[entering];
+			mark_id++;
+			for (int u = a; u != graph<int>::no_parent; u = parent[u])
+				mark[u] = mark_id;
+			int join = b;
+			while (mark[join] != mark_id)
+				join = parent[join];
+			T delta = res[entering];
+			for (int u = a; u != join; u = parent[u])
+				delta = std::min(delta, res[parent_edge[u]]);
+			for (int u = b; u != join; u = parent[u])
+				delta = std::min(delta, res[parent_edge[u] ^ 1]);
+			// the last blocking arc along the cycle leaves the tree, which
+			// keeps the tree strongly feasible and prevents cycling
+			int leaving = -1;
+			bool leaving_b_side = false;
+			for (int u = b; u != join; u = parent[u]) {
+				if (res[parent_edge[u] ^ 1] == delta)
+					leaving = u, leaving_b_side = true;
+			}
+			if (leaving == -1 && res[entering] != delta) {
+				for (int u = a; u != join; u = parent[u]) {
+					if (res[parent_edge[u]] == delta) {
+						leaving = u;
+						break;
+					}
+				}
+			}
+			res[entering] -= delta;
+			res[entering ^ 1] += delta;
+			for (int u = a; u != join; u = parent[u]) {
+				res[parent_edge[u]] -= delta;
+				res[parent_edge[u] ^ 1] += delta;
+			}
+			for (int u = b; u != join; u = parent[u]) {
+				res[parent_edge[u] ^ 1] -= delta;
+				res[parent_edge[u]] += delta;
+			}
+			if (leaving != -1) {
+				// re-hang the detached subtree below the entering arc
+				int u = leaving_b_side ? b : a;
+				int new_parent = leaving_b_side ? a : b;
+				int new_edge = leaving_b_side ? entering : entering ^ 1;
+				while (true) {
+					int old_parent = parent[u], old_edge = parent_edge[u];
+					parent[u] = new_parent;
+					parent_edge[u] = new_edge;
+					if (u == leaving)
+						break;
+					new_parent = u;
+					new_edge = old_edge ^ 1;
+					u = old_parent;
+				}
+			}
+			stamp[root] = ++now;
+		}
+		bool feasible = true;
+		for (int e = m; e < total; e += 2) {
+			if (res[e ^ 1] > 0)
+				feasible = false;
+		}
+		to.resize(m);
+		cost.resize(m);
+		res.resize(m);
+		return feasible;
+	}
+
+	// shortest distances from source on the residual network: zero when no
+	// residual arc has negative cost, relaxation in topological order when the
+	// residual network is acyclic, and Bellman-Ford with the SLF heuristic
+	// otherwise
+	std::vector<T> initial_potential() {
+		bool non_negative = true;
+		std::vector<int> in_degree(n);
+		for (int u = 0; u < n; u++) {
+			for (int i = 0; i < std::ssize(g[u]); i++) {
+				const edge &e = edges[g.dat[u][i]];
+				if (e.flow >= e.cap)
+					continue;
+				non_negative &= e.cost >= 0;
+				in_degree[g[u][i]]++;
+			}
+		}
+		if (non_negative)
+			return std::vector<T>(n);
+		std::vector<T> distance(n, cp_limits<T>::infinity());
+		distance[source] = 0;
+		std::vector<int> order;
+		for (int u = 0; u < n; u++) {
+			if (in_degree[u] == 0)
+				order.push_back(u);
+		}
+		for (size_t head = 0; head < order.size(); head++) {
+			int u = order[head];
+			for (int i = 0; i < std::ssize(g[u]); i++) {
+				const edge &e = edges[g.dat[u][i]];
+				int v = g[u][i];
+				if (e.flow >= e.cap)
+					continue;
+				if (distance[u] != cp_limits<T>::infinity())
+					distance[v] = std::min(distance[v], distance[u] + e.cost);
+				if (--in_degree[v] == 0)
+					order.push_back(v);
+			}
+		}
+		if (std::ssize(order) == n)
+			return distance;
+		std::fill(distance.begin(), distance.end(), cp_limits<T>::infinity());
+		in_queue.resize(n);
+		std::deque<int> q;
+		q.push_back(source);
+		distance[source] = 0;
+		in_queue[source] = 1;
+		while (!q.empty()) {
+			int u = q.front();
+			q.pop_front();
+			in_queue[u] = 0;
+			for (int i = 0; i < std::ssize(g[u]); i++) {
+				const edge &e = edges[g.dat[u][i]];
+				int v = g[u][i];
+				if (e.flow >= e.cap)
+					continue;
+				if (T new_dist = distance[u] + e.cost; new_dist < distance[v]) {
+					distance[v] = new_dist;
+					if (in_queue[v])
+						continue;
+					// small label first: closer nodes are relaxed earlier
+					if (!q.empty() && new_dist < distance[q.front()])
+						q.push_front(v);
+					else
+						q.push_back(v);
+					in_queue[v] = 1;
+				}
+			}
+		}
+		return distance;
+	}
+
+	// residual network and node excesses (supply minus net outflow) of the
+	// current flow
+	std::tuple<std::vector<int>, std::vector<T>, std::vector<T>>
+	residual_network() const {
+		std::vector<int> to(edges.size());
+		std::vector<T> res(edges.size()), excess(supply);
+		for (int u = 0; u < n; u++) {
+			for (int i = 0; i < std::ssize(g[u]); i++) {
+				int ei = g.dat[u][i];
+				to[ei] = g[u][i];
+				res[ei] = edges[ei].cap - edges[ei].flow;
+				excess[u] -= edges[ei].flow;
+			}
+		}
+		return {std::move(to), std::move(res), std::move(excess)};
+	}
+
+	// lower bounds are stored as supplies, which only network simplex honors
+	bool has_supplies() const {
+		return std::ranges::any_of(supply, [](T x) { return x != 0; });
+	}
+
+	T apply_residual(const std::vector<T> &res) {
+		T total_cost = lower_cost;
+		for (int i = 0; i < std::ssize(edges); i++) {
+			edges[i].flow = edges[i].cap - res[i];
+			if (i % 2 == 0)
+				total_cost += edges[i].flow * edges[i].cost;
+		}
+		return total_cost;
+	}
 
   public:
 	static constexpr int inf = cp_limits<int>::infinity();
 
 	cost_flow_net(int n, int source, int sink)
-	    : n(n), g(n), source(source), sink(sink) {}
+	    : n(n), g(n), supply(n), source(source), sink(sink) {}
 	explicit cost_flow_net(int n) : cost_flow_net(n, n - 2, n - 1) {}
 
 	void push_edge(int u, int v, T cap, T cost) {
@@ -124,9 +517,23 @@ template <class T> class cost_flow_net {
 		edges.push_back({0, 0, -cost});
 	}
 
+	// edge carrying at least lower units of flow, only supported by the
+	// network simplex solvers
+	void push_edge(int u, int v, T lower, T cap, T cost) {
+		supply[u] -= lower;
+		supply[v] += lower;
+		lower_cost += lower * cost;
+		push_edge(u, v, cap - lower, cost);
+	}
+
+	// positive amount for supply, negative for demand, only supported by the
+	// network simplex solvers
+	void push_supply(int u, T amount) { supply[u] += amount; }
+
 	void set_k_flow(int k) {
 		int new_source = n++;
 		g.resize(n);
+		supply.resize(n);
 		push_edge(new_source, source, k, 0);
 		source = new_source;
 	}
@@ -135,12 +542,13 @@ template <class T> class cost_flow_net {
 	int get_sink() const { return sink; }
 
 	std::pair<T, T> dinic_mcmf() {
+		assert(!has_supplies());
 		T max_flow = 0, total_cost = 0;
 		std::vector<T> distance;
 		std::vector<int> visited(n), current_index(n);
 		auto spfa = [&]() {
 			distance.assign(n, cp_limits<T>::infinity());
-			std::vector<int> in_queue(n);
+			in_queue.resize(n);
 			std::queue<int> q;
 			q.push(source);
 			distance[source] = 0;
@@ -203,34 +611,8 @@ template <class T> class cost_flow_net {
 	}
 
 	std::pair<T, T> primal_dual_mcmf() {
-		auto spfa = [&]() {
-			std::vector<T> distance(n, cp_limits<T>::infinity());
-			std::vector<int> in_queue(n);
-			std::queue<int> q;
-			q.push(source);
-			distance[source] = 0;
-			in_queue[source] = 1;
-			while (!q.empty()) {
-				int u = q.front();
-				q.pop();
-				in_queue[u] = 0;
-				for (int i = 0; i < std::ssize(g[u]); i++) {
-					int ei = g.dat[u][i];
-					edge &e = edges[ei];
-					int v = g[u][i];
-					if (e.flow >= e.cap)
-						continue;
-					if (T new_dist = distance[u] + e.cost;
-					    new_dist < distance[v]) {
-						distance[v] = new_dist;
-						if (!in_queue[v])
-							q.push(v), in_queue[v] = 1;
-					}
-				}
-			}
-			return distance;
-		};
-		std::vector<T> potential = spfa();
+		assert(!has_supplies());
+		std::vector<T> potential = initial_potential();
 		std::vector<T> distance;
 		std::vector<int> visited(n), current_index(n);
 		auto dijkstra = [&]() {
@@ -305,6 +687,49 @@ template <class T> class cost_flow_net {
 		}
 		return {total_cost, max_flow};
 	}
+
+	/**
+	 * Min cost flow satisfying all supplies, demands and lower bounds.
+	 * Returns the total cost, or std::nullopt if no feasible flow exists.
+	 */
+	std::optional<T> network_simplex_b_flow() {
+		auto [to, res, excess] = residual_network();
+		std::vector<simplex_cost> cost(edges.size());
+		for (int i = 0; i < std::ssize(edges); i++)
+			cost[i] = edges[i].cost;
+		if (!network_simplex(to, cost, res, excess))
+			return std::nullopt;
+		return apply_residual(res);
+	}
+
+	/**
+	 * Min cost max flow from source to sink on top of the supplies, demands
+	 * and lower bounds. Returns the total cost and the source to sink flow,
+	 * or std::nullopt if the supplies cannot be satisfied.
+	 */
+	std::optional<std::pair<T, T>> network_simplex_mcmf() {
+		auto [to, res, excess] = residual_network();
+		const int m = edges.size();
+		// maximize the flow on an extra sink -> source arc ignoring costs
+		std::vector<simplex_cost> cost(m);
+		to.push_back(source);
+		to.push_back(sink);
+		cost.push_back(-1);
+		cost.push_back(1);
+		res.push_back(cp_limits<T>::infinity());
+		res.push_back(0);
+		if (!network_simplex(to, cost, res, excess))
+			return std::nullopt;
+		T max_flow = res[m + 1];
+		to.resize(m);
+		cost.resize(m);
+		res.resize(m);
+		// then minimize the cost while keeping every node balanced
+		for (int i = 0; i < m; i++)
+			cost[i] = edges[i].cost;
+		network_simplex(to, cost, res, std::vector<T>(n));
+		return std::pair<T, T>{apply_residual(res), max_flow};
+	}
 };
 
 #endif
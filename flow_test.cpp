@@ -1,7 +1,10 @@
 #include "flow.hpp"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <random>
+
 TEST_CASE("dinic max flow", "[flow]") {
 	flow_net<int> mxf(4, 3, 2);
 	mxf.push_edge(3, 1, 30);
@@ -35,3 +38,218 @@ TEST_CASE("primal dual min cost max flow", "[flow]") {
 	REQUIRE(flow == 50);
 	REQUIRE(cost == 280);
 }
+
+TEST_CASE("primal dual min cost max flow with negative costs", "[flow]") {
+	SECTION("acyclic residual network") {
+		cost_flow_net<int> mcmf(4, 3, 2);
+		mcmf.push_edge(3, 1, 30, -2);
+		mcmf.push_edge(3, 2, 20, 3);
+		mcmf.push_edge(1, 2, 20, 1);
+		mcmf.push_edge(1, 0, 30, -9);
+		mcmf.push_edge(0, 2, 30, 5);
+		auto [cost, flow] = mcmf.primal_dual_mcmf();
+		REQUIRE(flow == 50);
+		REQUIRE(cost == -120);
+	}
+	SECTION("cyclic residual network") {
+		cost_flow_net<int> mcmf(4, 3, 2);
+		mcmf.push_edge(3, 1, 30, 2);
+		mcmf.push_edge(3, 2, 20, 3);
+		mcmf.push_edge(1, 2, 20, 1);
+		mcmf.push_edge(1, 0, 30, -4);
+		mcmf.push_edge(0, 1, 10, 5);
+		mcmf.push_edge(0, 2, 30, 5);
+		auto [cost, flow] = mcmf.primal_dual_mcmf();
+		REQUIRE(flow == 50);
+		REQUIRE(cost == 150);
+	}
+}
+
+TEST_CASE("network simplex min cost max flow", "[flow]") {
+	cost_flow_net<int> mcmf(4, 3, 2);
+	mcmf.push_edge(3, 1, 30, 2);
+	mcmf.push_edge(3, 2, 20, 3);
+	mcmf.push_edge(1, 2, 20, 1);
+	mcmf.push_edge(1, 0, 30, 9);
+	mcmf.push_edge(0, 2, 30, 5);
+	auto result = mcmf.network_simplex_mcmf();
+	REQUIRE(result.has_value());
+	auto [cost, flow] = *result;
+	REQUIRE(flow == 50);
+	REQUIRE(cost == 280);
+}
+
+TEST_CASE("network simplex min cost max flow with lower bounds", "[flow]") {
+	cost_flow_net<int> mcmf(4, 3, 2);
+	mcmf.push_edge(3, 1, 30, 2);
+	mcmf.push_edge(3, 2, 20, 3);
+	mcmf.push_edge(1, 2, 20, 1);
+	mcmf.push_edge(1, 0, 25, 30, 9);
+	mcmf.push_edge(0, 2, 30, 5);
+	auto result = mcmf.network_simplex_mcmf();
+	REQUIRE(result.has_value());
+	auto [cost, flow] = *result;
+	REQUIRE(flow == 50);
+	REQUIRE(cost == 475);
+}
+
+TEST_CASE("network simplex with large int costs", "[flow]") {
+	// (max cost + 1) * (n + 1) does not fit in an int
+	const int n = 3000;
+	cost_flow_net<int> mcmf(n, 0, n - 1);
+	mcmf.push_edge(0, 1, 1, 1'000'000);
+	mcmf.push_edge(0, 2, 1, 999'999);
+	mcmf.push_edge(1, n - 1, 1, 0);
+	mcmf.push_edge(2, n - 1, 1, 0);
+	mcmf.push_edge(1, 2, 1, -1'000'000);
+	auto result = mcmf.network_simplex_mcmf();
+	REQUIRE(result.has_value());
+	REQUIRE(*result == std::pair{1'999'999, 2});
+}
+
+TEST_CASE("network simplex min cost b-flow", "[flow]") {
+	cost_flow_net<int> mcf(4, 0, 3);
+	mcf.push_edge(0, 1, 3, 1);
+	mcf.push_edge(1, 3, 3, 1);
+	mcf.push_edge(2, 3, 3, 1);
+	mcf.push_edge(1, 2, 1, 0);
+	SECTION("supplies and demands are satisfied") {
+		mcf.push_edge(0, 2, 3, 3);
+		mcf.push_supply(0, 4);
+		mcf.push_supply(3, -4);
+		REQUIRE(mcf.network_simplex_b_flow() == 10);
+	}
+	SECTION("lower bounds are satisfied") {
+		mcf.push_edge(0, 2, 2, 3, 3);
+		mcf.push_supply(0, 4);
+		mcf.push_supply(3, -4);
+		REQUIRE(mcf.network_simplex_b_flow() == 12);
+	}
+	SECTION("infeasible supplies are reported") {
+		mcf.push_edge(0, 2, 3, 3);
+		mcf.push_supply(0, 7);
+		mcf.push_supply(3, -7);
+		REQUIRE(mcf.network_simplex_b_flow() == std::nullopt);
+	}
+}
+
+TEST_CASE("network simplex agrees with primal dual", "[flow]") {
+	std::mt19937 rng(12345);
+	auto next_rand = [&](unsigned bound) {
+		return static_cast<int>(rng() % bound);
+	};
+	for (int trial = 0; trial < 50; trial++) {
+		const int n = 8;
+		cost_flow_net<long long> a(n, 0, n - 1), b(n, 0, n - 1);
+		for (int i = 0; i < 20; i++) {
+			int u = next_rand(n), v = next_rand(n);
+			long long cap = next_rand(10), cost = next_rand(20);
+			a.push_edge(u, v, cap, cost);
+			b.push_edge(u, v, cap, cost);
+		}
+		REQUIRE(a.network_simplex_mcmf() == b.primal_dual_mcmf());
+	}
+}
+
+TEST_CASE("min cost max flow solvers benchmark", "[flow][.][benchmark]") {
+	auto build = [] {
+		const int layers = 6, width = 10, n = layers * width + 2;
+		cost_flow_net<long long> mcmf(n);
+		std::mt19937 rng(0);
+		auto next_rand = [&](unsigned bound) {
+			return static_cast<long long>(rng() % bound);
+		};
+		for (int i = 0; i < width; i++) {
+			mcmf.push_edge(mcmf.get_source(), i, 1'000, 0);
+			mcmf.push_edge((layers - 1) * width + i, mcmf.get_sink(), 1'000, 0);
+		}
+		for (int l = 0; l + 1 < layers; l++) {
+			for (int i = 0; i < width; i++) {
+				for (int k = 0; k < 5; k++) {
+					mcmf.push_edge(l * width + i,
+					               (l + 1) * width + next_rand(width),
+					               next_rand(100) + 1, next_rand(1'000));
+				}
+			}
+		}
+		return mcmf;
+	};
+	BENCHMARK("dinic_mcmf") { return build().dinic_mcmf(); };
+	BENCHMARK("primal_dual_mcmf") { return build().primal_dual_mcmf(); };
+	BENCHMARK("network_simplex_mcmf") {
+		return build().network_simplex_mcmf();
+	};
+}
+
+TEST_CASE("hopcroft karp bipartite matching", "[flow]") {
+	graph<void> g(7);
+	g.push_edge(0, 3);
+	g.push_edge(0, 4);
+	g.push_edge(1, 3);
+	g.push_edge(2, 3);
+	g.push_edge(2, 5);
+	g.push_edge(2, 6);
+	bipartite_matching bm(g, 3);
+	REQUIRE(bm.max_matching() == 3);
+	REQUIRE(bm.get_match(1) == 3);
+	REQUIRE(bm.get_match(3) == 1);
+	REQUIRE(bm.get_match(0) == 4);
+	REQUIRE(bm.matching().size() == 3);
+	auto cover = bm.min_vertex_cover();
+	REQUIRE(cover.size() == 3);
+	std::vector<int> in_cover(7);
+	for (int u : cover)
+		in_cover[u] = true;
+	for (auto [u, v] : g.edge_list())
+		REQUIRE((in_cover[u] || in_cover[v]));
+}
+
+TEST_CASE("hopcroft karp agrees with dinic max flow", "[flow]") {
+	std::mt19937 rng(2024);
+	auto next_rand = [&](unsigned bound) {
+		return static_cast<int>(rng() % bound);
+	};
+	for (int trial = 0; trial < 50; trial++) {
+		const int n_left = 6, n_right = 7, n = n_left + n_right;
+		graph<void> g(n);
+		flow_net<int> mxf(n + 2);
+		for (int u = 0; u < n_left; u++)
+			mxf.push_edge(mxf.get_source(), u, 1);
+		for (int v = n_left; v < n; v++)
+			mxf.push_edge(v, mxf.get_sink(), 1);
+		for (int i = 0; i < 12; i++) {
+			int u = next_rand(n_left), v = n_left + next_rand(n_right);
+			g.push_edge(u, v);
+			mxf.push_edge(u, v, 1);
+		}
+		bipartite_matching bm(g, n_left);
+		int matched = bm.max_matching();
+		REQUIRE(matched == mxf.dinic_max_flow());
+		REQUIRE(std::ssize(bm.min_vertex_cover()) == matched);
+	}
+}
+
+TEST_CASE("bipartite matching benchmark", "[flow][.][benchmark]") {
+	const int n_left = 2'000, n_right = 2'000, n = n_left + n_right;
+	std::vector<std::pair<int, int>> edges;
+	std::mt19937 rng(0);
+	for (int i = 0; i < 10'000; i++) {
+		int u = rng() % n_left;
+		edges.emplace_back(u, n_left + rng() % n_right);
+	}
+	BENCHMARK("dinic_max_flow") {
+		flow_net<int> mxf(n + 2);
+		for (int u = 0; u < n_left; u++)
+			mxf.push_edge(mxf.get_source(), u, 1);
+		for (int v = n_left; v < n; v++)
+			mxf.push_edge(v, mxf.get_sink(), 1);
+		for (auto [u, v] : edges)
+			mxf.push_edge(u, v, 1);
+		return mxf.dinic_max_flow();
+	};
+	BENCHMARK("bipartite_matching") {
+		graph<void> g(n, edges);
+		bipartite_matching bm(g, n_left);
+		return bm.max_matching();
+	};
+}
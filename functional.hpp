@@ -8,8 +8,12 @@
 #define FUNCTIONAL_HPP
 
 #include <algorithm>
+#include <concepts>
 #include <functional>
+#include <limits>
 #include <numeric>
+#include <optional>
+#include <type_traits>
 
 namespace fn {
 template <class T = void, class Proj = std::identity,
@@ -97,6 +101,193 @@ struct noop {
 	}
 };
 
+template <class T> struct constant {
+	T value;
+	template <class... Args>
+	constexpr const T &operator()(Args &&...) const noexcept {
+		return value;
+	}
+};
+
+template <class T>
+concept arithmetic = std::is_arithmetic_v<T>;
+
+// identity element of Op over T, specialize it for custom operations
+template <class Op, class T> struct identity_element {};
+template <arithmetic T> struct identity_element<std::plus<>, T> {
+	static constexpr T value() { return T(0); }
+};
+template <arithmetic T> struct identity_element<std::multiplies<>, T> {
+	static constexpr T value() { return T(1); }
+};
+template <std::integral T> struct identity_element<std::bit_or<>, T> {
+	static constexpr T value() { return T(0); }
+};
+template <std::integral T> struct identity_element<std::bit_and<>, T> {
+	static constexpr T value() { return ~T(0); }
+};
+template <std::integral T> struct identity_element<std::bit_xor<>, T> {
+	static constexpr T value() { return T(0); }
+};
+template <arithmetic T, class U> struct identity_element<minimum<U>, T> {
+	static constexpr T value() {
+		if constexpr (std::numeric_limits<T>::has_infinity)
+			return std::numeric_limits<T>::infinity();
+		else
+			return std::numeric_limits<T>::max();
+	}
+};
+template <arithmetic T, class U> struct identity_element<maximum<U>, T> {
+	static constexpr T value() {
+		if constexpr (std::numeric_limits<T>::has_infinity)
+			return -std::numeric_limits<T>::infinity();
+		else
+			return std::numeric_limits<T>::lowest();
+	}
+};
+template <std::integral T, class U> struct identity_element<gcd<U>, T> {
+	static constexpr T value() { return T(0); }
+};
+
+// inverse of an element under Op, specialize it for custom operations
+template <class Op, class T> struct inverse_element {};
+template <arithmetic T> struct inverse_element<std::plus<>, T> {
+	static constexpr T value(const T &x) { return -x; }
+};
+template <std::integral T> struct inverse_element<std::bit_xor<>, T> {
+	static constexpr T value(const T &x) { return x; }
+};
+
+// whether op(x, x) == x, which allows overlapping ranges to be combined,
+// custom operations opt in with `using is_idempotent = std::true_type;` or a
+// specialization
+template <class Op>
+inline constexpr bool is_idempotent =
+    requires { requires Op::is_idempotent::value; };
+template <class T, class Proj, class Comp>
+inline constexpr bool is_idempotent<minimum<T, Proj, Comp>> = true;
+template <class T, class Proj, class Comp>
+inline constexpr bool is_idempotent<maximum<T, Proj, Comp>> = true;
+template <class T> inline constexpr bool is_idempotent<gcd<T>> = true;
+template <> inline constexpr bool is_idempotent<std::bit_or<>> = true;
+template <> inline constexpr bool is_idempotent<std::bit_and<>> = true;
+
+// whether op(x, y) is always one of x and y, opted into like is_idempotent
+template <class Op>
+inline constexpr bool is_selective =
+    requires { requires Op::is_selective::value; };
+template <class T, class Proj, class Comp>
+inline constexpr bool is_selective<minimum<T, Proj, Comp>> = true;
+template <class T, class Proj, class Comp>
+inline constexpr bool is_selective<maximum<T, Proj, Comp>> = true;
+
+template <class Op, class T>
+concept has_identity = requires {
+	{ identity_element<Op, T>::value() } -> std::convertible_to<T>;
+};
+
+template <class Op, class T>
+concept semigroup =
+    std::regular_invocable<Op, const T &, const T &> &&
+    std::convertible_to<std::invoke_result_t<Op, const T &, const T &>, T>;
+
+template <class Op, class T>
+concept monoid = semigroup<Op, T> && has_identity<Op, T>;
+
+template <class Op, class T>
+concept idempotent_monoid = monoid<Op, T> && is_idempotent<Op>;
+
+template <class Op, class T>
+concept group = monoid<Op, T> && requires(const T &x) {
+	{ inverse_element<Op, T>::value(x) } -> std::convertible_to<T>;
+};
+
+/**
+ * Tags of type U composed with CombineUpdateOp act on values of type T
+ * through UpdateOp after being scaled to a segment length by UpdateLenOp.
+ * The identity tag is expected to leave every value unchanged.
+ */
+template <class T, class U, class UpdateOp, class CombineUpdateOp,
+          class UpdateLenOp>
+concept monoid_action =
+    monoid<CombineUpdateOp, U> &&
+    requires(T x, U a, size_t len, UpdateOp updater,
+             UpdateLenOp updaterLen) {
+	    { updater(x, updaterLen(a, len)) } -> std::convertible_to<T>;
+    };
+
+// identity of Op over T, as the default for structures that take the
+// identity as an argument, operations without a known identity must pass it
+template <class Op, class T> constexpr T default_identity() {
+	static_assert(monoid<Op, T>, "no identity_element for this operation, "
+	                             "pass the identity explicitly");
+	return identity_element<Op, T>::value();
+}
+
+/**
+ * Pending tags of a lazy segment tree. When CombineUpdateOp has an identity
+ * the tags are plain U starting at it, so pushes need no emptiness check,
+ * otherwise they are std::optional<U> starting empty.
+ */
+template <class T, class U, class UpdateOp, class CombineUpdateOp,
+          class UpdateLenOp>
+struct lazy_tag {
+	static constexpr bool has_identity = monoid<CombineUpdateOp, U>;
+	static_assert(!has_identity || monoid_action<T, U, UpdateOp,
+	                                             CombineUpdateOp, UpdateLenOp>);
+	using type = std::conditional_t<has_identity, U, std::optional<U>>;
+
+	static type empty() {
+		if constexpr (has_identity)
+			return identity_element<CombineUpdateOp, U>::value();
+		else
+			return std::nullopt;
+	}
+
+	// the pending update, or nullptr if there is none
+	static const U *get(const type &tag) {
+		if constexpr (has_identity)
+			return &tag;
+		else
+			return tag ? &*tag : nullptr;
+	}
+
+	// composes val after the pending update
+	static void compose(type &tag, const U &val, CombineUpdateOp &op) {
+		if constexpr (has_identity)
+			tag = op(tag, val);
+		else
+			tag = tag ? op(*tag, val) : val;
+	}
+};
+
+/**
+ * Running result of a range query folded left to right with Op. Starts at
+ * the identity when Op has one, otherwise at a value-initialized T that the
+ * first value replaces, so the query must cover at least one element.
+ */
+template <class Op, class T> class fold_result {
+	static constexpr bool has_identity = monoid<Op, T>;
+	T res{};
+	bool empty = !has_identity;
+
+  public:
+	fold_result() {
+		if constexpr (has_identity)
+			res = identity_element<Op, T>::value();
+	}
+	void add(const T &val, const Op &op) {
+		if constexpr (!has_identity) {
+			if (empty) {
+				res = val, empty = false;
+				return;
+			}
+		}
+		res = op(res, val);
+	}
+	T value() const { return res; }
+};
+
 } // namespace fn
 
 #endif
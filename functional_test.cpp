@@ -2,6 +2,7 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -63,3 +64,39 @@ TEST_CASE("fn::gcd object", "[functional]") {
 		REQUIRE(gcd_obj(5, 0) == 5);
 	}
 }
+
+TEST_CASE("fn::identity_element and monoid_action", "[functional]") {
+	REQUIRE(fn::identity_element<std::plus<>, int>::value() == 0);
+	REQUIRE(fn::identity_element<std::multiplies<>, long long>::value() == 1);
+	REQUIRE(fn::identity_element<std::bit_xor<>, unsigned>::value() == 0);
+	REQUIRE(fn::identity_element<fn::minimum<>, int>::value() ==
+	        std::numeric_limits<int>::max());
+	REQUIRE(fn::identity_element<fn::maximum<>, double>::value() ==
+	        -std::numeric_limits<double>::infinity());
+	REQUIRE(fn::identity_element<fn::gcd<>, long long>::value() == 0);
+	REQUIRE(fn::inverse_element<std::plus<>, int>::value(5) == -5);
+	STATIC_REQUIRE(fn::has_identity<std::plus<>, int>);
+	STATIC_REQUIRE(!fn::has_identity<fn::assign, int>);
+	STATIC_REQUIRE(fn::monoid_action<long long, int, std::plus<>, std::plus<>,
+	                                 std::multiplies<>>);
+	STATIC_REQUIRE(
+	    !fn::monoid_action<int, int, fn::assign, fn::assign, fn::noop>);
+}
+
+TEST_CASE("algebraic concepts", "[functional]") {
+	STATIC_REQUIRE(fn::monoid<std::plus<>, int>);
+	STATIC_REQUIRE(fn::group<std::plus<>, int>);
+	STATIC_REQUIRE(fn::group<std::bit_xor<>, unsigned>);
+	STATIC_REQUIRE(!fn::group<std::multiplies<>, int>);
+	STATIC_REQUIRE(fn::idempotent_monoid<fn::minimum<>, int>);
+	STATIC_REQUIRE(fn::idempotent_monoid<fn::gcd<>, int>);
+	STATIC_REQUIRE(!fn::idempotent_monoid<std::plus<>, int>);
+	STATIC_REQUIRE(!fn::monoid<std::plus<>, std::pair<int, int>>);
+	// a minimum with projection is idempotent but its identity is unknown
+	auto proj = [](int x) { return -x; };
+	using min_proj = decltype(fn::minimum({}, proj));
+	STATIC_REQUIRE(fn::is_idempotent<min_proj>);
+	STATIC_REQUIRE(fn::is_selective<min_proj>);
+	STATIC_REQUIRE(!fn::is_selective<fn::gcd<>>);
+	STATIC_REQUIRE(!fn::monoid<min_proj, int>);
+}
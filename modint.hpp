@@ -8,6 +8,8 @@
 
 #include <iostream>
 
+#include "functional.hpp"
+
 template <std::signed_integral T = int, T MOD = 1'000'000'007> class modint;
 
 template <std::signed_integral T, T MOD>
@@ -114,6 +116,23 @@ std::istream &operator>>(std::istream &is, modint<T, MOD> &arg) {
 	return is;
 }
 
+namespace fn {
+template <std::signed_integral T, T MOD>
+struct identity_element<std::plus<>, modint<T, MOD>> {
+	static constexpr modint<T, MOD> value() { return 0; }
+};
+template <std::signed_integral T, T MOD>
+struct identity_element<std::multiplies<>, modint<T, MOD>> {
+	static constexpr modint<T, MOD> value() { return 1; }
+};
+template <std::signed_integral T, T MOD>
+struct inverse_element<std::plus<>, modint<T, MOD>> {
+	static constexpr modint<T, MOD> value(const modint<T, MOD> &x) {
+		return -x;
+	}
+};
+} // namespace fn
+
 using mint_1097 = modint<>;
 using mint_1099 = modint<int, 1'000'000'009>;
 using mint_998 = modint<int, 998'244'353>;
@@ -0,0 +1,160 @@
+/**
+ * @file mst.hpp
+ * @brief Minimum spanning tree (forest) algorithms
+ */
+
+#ifndef MST_HPP
+#define MST_HPP
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "dsu.hpp"
+#include "graph.hpp"
+#include "parallel.hpp"
+
+/**
+ * Edges are treated as undirected. Each function returns the total weight and
+ * the minimum spanning forest as an undirected graph.
+ */
+template <class T> using mst_result = std::pair<T, graph<T>>;
+
+/**
+ * Kruskal's algorithm with the edges sorted by parallel_sort.
+ */
+template <class T>
+mst_result<T> kruskal_mst(const graph<T> &g,
+                          unsigned threads = default_thread_count()) {
+	auto edges = g.edge_list();
+	parallel_sort(
+	    edges.begin(), edges.end(),
+	    [](const auto &a, const auto &b) { return a.second < b.second; },
+	    threads);
+	dsu<> d(g.size());
+	T total_weight = 0;
+	graph<T> tree(g.size());
+	for (const auto &[e, w] : edges) {
+		if (d.union_sets(e.first, e.second) != d.same_set) {
+			total_weight += w;
+			tree.push_undirected_edge(e.first, e.second, w);
+		}
+	}
+	return {total_weight, std::move(tree)};
+}
+
+/**
+ * Filter-Kruskal: the heavier half of the edges is only sorted after the
+ * lighter half has been processed and the edges it closed cycles with have
+ * been filtered out, which pays off on dense graphs.
+ */
+template <class T> mst_result<T> filter_kruskal_mst(const graph<T> &g) {
+	auto edges = g.edge_list();
+	dsu<> d(g.size());
+	T total_weight = 0;
+	graph<T> tree(g.size());
+	auto by_weight = [](const auto &a, const auto &b) {
+		return a.second < b.second;
+	};
+	auto filter_kruskal = [&](auto &self, auto first, auto last) -> void {
+		// short ranges are cheaper to sort than to partition
+		if (last - first <= 64) {
+			std::sort(first, last, by_weight);
+			for (auto it = first; it != last; ++it) {
+				const auto &[e, w] = *it;
+				if (d.union_sets(e.first, e.second) != d.same_set) {
+					total_weight += w;
+					tree.push_undirected_edge(e.first, e.second, w);
+				}
+			}
+			return;
+		}
+		auto mid = first + (last - first) / 2;
+		std::nth_element(first, mid, last, by_weight);
+		self(self, first, mid);
+		last = std::remove_if(mid, last, [&](const auto &edge) {
+			return d.find_set(edge.first.first) ==
+			       d.find_set(edge.first.second);
+		});
+		self(self, mid, last);
+	};
+	filter_kruskal(filter_kruskal, edges.begin(), edges.end());
+	return {total_weight, std::move(tree)};
+}
+
+/**
+ * Boruvka's algorithm, searching the cheapest edge leaving each component
+ * with one thread per slice of the edge list.
+ */
+template <class T>
+mst_result<T> boruvka_mst(const graph<T> &g,
+                          unsigned threads = default_thread_count()) {
+	static constexpr int none = -1;
+	threads = std::max(threads, 1u);
+	const int n = g.size();
+	auto edges = g.edge_list();
+	dsu<> d(n);
+	std::vector<int> component(n);
+	std::vector<std::vector<int>> cheapest(threads, std::vector<int>(n));
+	T total_weight = 0;
+	graph<T> tree(n);
+	// ties are broken by index so that no cycle is ever selected
+	auto lighter = [&](int i, int j) {
+		return j == none || std::tie(edges[i].second, i) <
+		                        std::tie(edges[j].second, j);
+	};
+	while (true) {
+		for (int u = 0; u < n; u++)
+			component[u] = d.find_set(u);
+		std::erase_if(edges, [&](const auto &edge) {
+			return component[edge.first.first] ==
+			       component[edge.first.second];
+		});
+		if (edges.empty())
+			break;
+		const size_t m = edges.size();
+		parallel_for(
+		    0, threads,
+		    [&](size_t lo, size_t hi) {
+			    for (size_t t = lo; t < hi; t++) {
+				    auto &best = cheapest[t];
+				    std::ranges::fill(best, none);
+				    for (size_t i = m * t / threads;
+				         i < m * (t + 1) / threads; i++) {
+					    int cu = component[edges[i].first.first];
+					    int cv = component[edges[i].first.second];
+					    if (lighter(i, best[cu]))
+						    best[cu] = i;
+					    if (lighter(i, best[cv]))
+						    best[cv] = i;
+				    }
+			    }
+		    },
+		    threads);
+		for (int u = 0; u < n; u++) {
+			if (component[u] != u)
+				continue;
+			int best = none;
+			for (unsigned t = 0; t < threads; t++) {
+				if (cheapest[t][u] != none && lighter(cheapest[t][u], best))
+					best = cheapest[t][u];
+			}
+			if (best == none)
+				continue;
+			const auto &[e, w] = edges[best];
+			if (d.union_sets(e.first, e.second) != d.same_set) {
+				total_weight += w;
+				tree.push_undirected_edge(e.first, e.second, w);
+			}
+		}
+	}
+	return {total_weight, std::move(tree)};
+}
+
+template <class T>
+mst_result<T> minimum_spanning_tree(const graph<T> &g,
+                                    unsigned threads = default_thread_count()) {
+	return kruskal_mst(g, threads);
+}
+
+#endif
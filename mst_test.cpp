@@ -0,0 +1,71 @@
+#include "mst.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <vector>
+
+TEST_CASE("minimum spanning tree of a small graph", "[mst]") {
+	graph<int> g(5);
+	g.push_undirected_edge(0, 1, 4);
+	g.push_undirected_edge(0, 2, 1);
+	g.push_undirected_edge(1, 2, 2);
+	g.push_undirected_edge(1, 3, 5);
+	g.push_undirected_edge(2, 3, 8);
+	g.push_undirected_edge(3, 4, 3);
+	for (auto [weight, tree] :
+	     {minimum_spanning_tree(g), kruskal_mst(g, 2), filter_kruskal_mst(g),
+	      boruvka_mst(g, 2)}) {
+		REQUIRE(weight == 11);
+		REQUIRE(tree.edge_list().size() == 8);
+		auto [color, components] = tree.get_connected_components();
+		REQUIRE(components.size() == 1);
+	}
+}
+
+TEST_CASE("minimum spanning forest of a disconnected graph", "[mst]") {
+	graph<long long> g(6);
+	g.push_edge(0, 1, 7);
+	g.push_edge(1, 2, 3);
+	g.push_edge(2, 0, 5);
+	g.push_edge(3, 4, 1);
+	REQUIRE(kruskal_mst(g).first == 9);
+	REQUIRE(filter_kruskal_mst(g).first == 9);
+	REQUIRE(boruvka_mst(g, 3).first == 9);
+	REQUIRE(boruvka_mst(g, 0).first == 9);
+	REQUIRE(boruvka_mst(g, 3).second.get_connected_components().second.size() ==
+	        3);
+}
+
+TEST_CASE("minimum spanning tree algorithms agree", "[mst]") {
+	std::mt19937 rng(5);
+	auto next_rand = [&](unsigned bound) {
+		return static_cast<int>(rng() % bound);
+	};
+	for (int trial = 0; trial < 20; trial++) {
+		const int n = 200;
+		graph<int> g(n);
+		for (int i = 0; i < 1'000; i++)
+			g.push_undirected_edge(next_rand(n), next_rand(n), next_rand(50));
+		int expected = kruskal_mst(g, 1).first;
+		REQUIRE(kruskal_mst(g, 4).first == expected);
+		REQUIRE(filter_kruskal_mst(g).first == expected);
+		REQUIRE(boruvka_mst(g, 1).first == expected);
+		REQUIRE(boruvka_mst(g, 4).first == expected);
+	}
+}
+
+TEST_CASE("minimum spanning tree benchmark", "[mst][.][benchmark]") {
+	const int n = 2'000;
+	graph<int> g(n);
+	std::mt19937 rng(0);
+	for (int i = 0; i < 10'000; i++) {
+		int u = rng() % n;
+		int v = rng() % n;
+		g.push_undirected_edge(u, v, rng() % 1'000'000);
+	}
+	BENCHMARK("kruskal_mst") { return kruskal_mst(g).first; };
+	BENCHMARK("filter_kruskal_mst") { return filter_kruskal_mst(g).first; };
+	BENCHMARK("boruvka_mst") { return boruvka_mst(g).first; };
+}
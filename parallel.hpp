@@ -0,0 +1,77 @@
+/**
+ * @file parallel.hpp
+ * @brief Fork-join helpers built on std::thread
+ */
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+inline unsigned default_thread_count() {
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Splits [first, last) into at most threads contiguous chunks and calls
+ * f(lo, hi) on each of them concurrently.
+ */
+template <class F>
+void parallel_for(size_t first, size_t last, F f,
+                  unsigned threads = default_thread_count()) {
+	size_t n = last - first;
+	size_t chunks = std::min<size_t>(threads, n);
+	if (chunks <= 1) {
+		if (n > 0)
+			f(first, last);
+		return;
+	}
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < chunks; i++)
+		workers.emplace_back(f, first + n * i / chunks,
+		                     first + n * (i + 1) / chunks);
+	f(first, first + n / chunks);
+	for (auto &w : workers)
+		w.join();
+}
+
+/**
+ * Sorts chunks concurrently, then merges adjacent chunks pairwise.
+ */
+template <class RandomIt, class Compare = std::less<>>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp = {},
+                   unsigned threads = default_thread_count()) {
+	static constexpr size_t serial_threshold = 1 << 14;
+	size_t n = last - first;
+	if (threads <= 1 || n < serial_threshold) {
+		std::sort(first, last, comp);
+		return;
+	}
+	std::vector<size_t> bounds(threads + 1);
+	for (size_t i = 0; i <= threads; i++)
+		bounds[i] = n * i / threads;
+	parallel_for(
+	    0, threads,
+	    [&](size_t lo, size_t hi) {
+		    for (size_t i = lo; i < hi; i++)
+			    std::sort(first + bounds[i], first + bounds[i + 1], comp);
+	    },
+	    threads);
+	for (size_t width = 1; width < threads; width *= 2) {
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i + width < threads; i += width * 2) {
+			size_t mid = bounds[i + width];
+			size_t hi = bounds[std::min<size_t>(i + width * 2, threads)];
+			workers.emplace_back([&comp, first, lo = bounds[i], mid, hi] {
+				std::inplace_merge(first + lo, first + mid, first + hi, comp);
+			});
+		}
+		for (auto &w : workers)
+			w.join();
+	}
+}
+
+#endif
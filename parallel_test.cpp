@@ -0,0 +1,33 @@
+#include "parallel.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+TEST_CASE("parallel_for visits every index once", "[parallel]") {
+	std::vector<int> visited(1'000);
+	parallel_for(
+	    0, visited.size(),
+	    [&](size_t lo, size_t hi) {
+		    for (size_t i = lo; i < hi; i++)
+			    visited[i]++;
+	    },
+	    4);
+	REQUIRE(std::ranges::count(visited, 1) == 1'000);
+	std::atomic<int> calls = 0;
+	parallel_for(3, 5, [&](size_t, size_t) { calls++; }, 8);
+	REQUIRE(calls == 2);
+}
+
+TEST_CASE("parallel_sort agrees with std::sort", "[parallel]") {
+	std::vector<int> v(100'000);
+	std::mt19937 rng(1);
+	for (int &x : v)
+		x = rng() % 1'000;
+	std::vector<int> expected = v;
+	std::ranges::sort(expected, std::ranges::greater{});
+	parallel_sort(v.begin(), v.end(), std::ranges::greater{}, 3);
+	REQUIRE(v == expected);
+}
@@ -11,11 +11,16 @@
 
 #include <algorithm>
 #include <bit>
+#include <concepts>
 #include <functional>
 #include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "functional.hpp"
+#include "parallel.hpp"
 
 template <class T, class U = T, class CombineOp = std::plus<>,
           class UpdateOp = std::plus<>>
@@ -25,17 +30,38 @@ class segment_tree {
 	CombineOp combinator;
 	UpdateOp updater;
 
+	// levels narrower than this are built by the calling thread
+	static constexpr size_t serial_threshold = 1 << 16;
+
   public:
+	/**
+	 * Builds the tree level by level. A level only reads the level below it,
+	 * so with threads > 1 wide levels are split across threads and give the
+	 * same tree as a serial build. CombineOp must then be safe to call
+	 * concurrently.
+	 */
 	explicit segment_tree(const std::vector<T> &init, CombineOp combinator = {},
-	                      UpdateOp updater = {})
+	                      UpdateOp updater = {},
+	                      unsigned threads = 1)
 	    : n(init.size()), tree(n), combinator(combinator), updater(updater) {
 		std::copy(init.begin(), init.end(), back_inserter(tree));
-		for (size_t i = n - 1; i > 0; i--)
-			tree[i] = combinator(tree[i << 1], tree[i << 1 | 1]);
+		auto calc = [this](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++)
+				tree[i] = this->combinator(tree[i << 1], tree[i << 1 | 1]);
+		};
+		// nodes of the current level lie in [lo, hi)
+		for (size_t hi = n, lo; hi > 1; hi = lo) {
+			lo = std::bit_floor(hi - 1);
+			if (threads > 1 && hi - lo >= serial_threshold)
+				parallel_for(lo, hi, calc, threads);
+			else
+				calc(lo, hi);
+		}
 	}
 	explicit segment_tree(int n, const T &init = {}, CombineOp combinator = {},
-	                      UpdateOp updater = {})
-	    : segment_tree(std::vector<T>(n, init), combinator, updater) {}
+	                      UpdateOp updater = {},
+	                      unsigned threads = 1)
+	    : segment_tree(std::vector<T>(n, init), combinator, updater, threads) {}
 
 	size_t size() const { return n; }
 
@@ -46,9 +72,54 @@ class segment_tree {
 			tree[p] = combinator(tree[p << 1], tree[p << 1 | 1]);
 	}
 
+	/**
+	 * Applies all point updates in order, then recomputes the dirty ancestors
+	 * level by level instead of walking to the root after each update. Once
+	 * the dirty nodes cover the upper levels densely, these are rebuilt
+	 * linearly.
+	 */
+	void modify_batch(std::span<const std::pair<size_t, U>> updates) {
+		std::vector<size_t> dirty;
+		dirty.reserve(updates.size());
+		for (const auto &[p, val] : updates) {
+			tree[p + n] = updater(tree[p + n], val);
+			if (dirty.empty() || dirty.back() != p + n)
+				dirty.push_back(p + n);
+		}
+		// nodes of the current level lie in [1, hi]
+		for (size_t hi = 2 * n - 1; !dirty.empty(); hi >>= 1) {
+			if (dirty.size() >= hi / 2) {
+				for (size_t p = hi >> 1; p > 0; p--)
+					tree[p] = combinator(tree[p << 1], tree[p << 1 | 1]);
+				return;
+			}
+			// a node may be computed before its dirty child of the same
+			// level, it is computed again with the next level
+			size_t m = 0;
+			for (size_t i = 0; i < dirty.size(); i++) {
+				size_t p = dirty[i] >> 1;
+				if (p == 0 || (m > 0 && dirty[m - 1] == p))
+					continue;
+				tree[p] = combinator(tree[p << 1], tree[p << 1 | 1]);
+				dirty[m++] = p;
+			}
+			dirty.resize(m);
+		}
+	}
+
 	T query(size_t l) const { return tree[l + n]; }
 
 	T query(size_t l, size_t r) const {
+		if constexpr (fn::monoid<CombineOp, T>) {
+			T resl = fn::identity_element<CombineOp, T>::value(), resr = resl;
+			for (l += n, r += n + 1; l < r; l >>= 1, r >>= 1) {
+				if (l & 1)
+					resl = combinator(resl, tree[l++]);
+				if (r & 1)
+					resr = combinator(tree[--r], resr);
+			}
+			return combinator(resl, resr);
+		}
 		std::optional<T> resl, resr;
 		for (l += n, r += n + 1; l < r; l >>= 1, r >>= 1) {
 			if (l & 1)
@@ -66,13 +137,221 @@ class segment_tree {
 	}
 };
 
+/**
+ * Bottom-up segment tree padded to a power of two, so that every node covers
+ * an aligned block and the combination order is preserved for
+ * non-commutative operations. Padding leaves hold the identity of
+ * CombineOp, which also enables the max_right/min_left binary searches.
+ */
+template <class T, class U = T, class CombineOp = std::plus<>,
+          class UpdateOp = std::plus<>>
+class padded_segment_tree {
+	size_t n, h, sz;
+	std::vector<T> tree;
+	T identity;
+	CombineOp combinator;
+	UpdateOp updater;
+
+	void calc(size_t p) {
+		tree[p] = combinator(tree[p << 1], tree[p << 1 | 1]);
+	}
+
+  public:
+	explicit padded_segment_tree(
+	    const std::vector<T> &init,
+	    const T &identity = fn::default_identity<CombineOp, T>(),
+	    CombineOp combinator = {}, UpdateOp updater = {})
+	    : n(init.size()), h(std::bit_width(std::bit_ceil(n)) - 1),
+	      sz(size_t{1} << h), tree(sz << 1, identity), identity(identity),
+	      combinator(combinator), updater(updater) {
+		std::copy(init.begin(), init.end(), tree.begin() + sz);
+		for (size_t i = sz - 1; i > 0; i--)
+			calc(i);
+	}
+	explicit padded_segment_tree(
+	    size_t n, const T &init = {},
+	    const T &identity = fn::default_identity<CombineOp, T>(),
+	    CombineOp combinator = {}, UpdateOp updater = {})
+	    : padded_segment_tree(std::vector<T>(n, init), identity, combinator,
+	                          updater) {}
+
+	size_t size() const { return n; }
+
+	void modify(size_t p, const U &val) {
+		p += sz;
+		tree[p] = updater(tree[p], val);
+		for (size_t i = 1; i <= h; i++)
+			calc(p >> i);
+	}
+
+	T query(size_t l) const { return tree[l + sz]; }
+
+	T query(size_t l, size_t r) const {
+		T resl = identity, resr = identity;
+		for (l += sz, r += sz + 1; l < r; l >>= 1, r >>= 1) {
+			if (l & 1)
+				resl = combinator(resl, tree[l++]);
+			if (r & 1)
+				resr = combinator(tree[--r], resr);
+		}
+		return combinator(resl, resr);
+	}
+
+	/**
+	 * Largest r in [l, n] such that pred holds for the combination of
+	 * [l, r). pred must be monotone and hold for the identity.
+	 */
+	template <std::predicate<const T &> Pred>
+	size_t max_right(size_t l, Pred pred) const {
+		if (l == n)
+			return n;
+		T acc = identity;
+		l += sz;
+		do {
+			while (l % 2 == 0)
+				l >>= 1;
+			if (!pred(combinator(acc, tree[l]))) {
+				while (l < sz) {
+					l <<= 1;
+					if (T next = combinator(acc, tree[l]); pred(next)) {
+						acc = next;
+						l++;
+					}
+				}
+				return l - sz;
+			}
+			acc = combinator(acc, tree[l++]);
+		} while (!std::has_single_bit(l));
+		return n;
+	}
+
+	/**
+	 * Smallest l in [0, r] such that pred holds for the combination of
+	 * [l, r). pred must be monotone and hold for the identity.
+	 */
+	template <std::predicate<const T &> Pred>
+	size_t min_left(size_t r, Pred pred) const {
+		if (r == 0)
+			return 0;
+		T acc = identity;
+		r += sz;
+		do {
+			r--;
+			while (r > 1 && r % 2 == 1)
+				r >>= 1;
+			if (!pred(combinator(tree[r], acc))) {
+				while (r < sz) {
+					r = r << 1 | 1;
+					if (T next = combinator(tree[r], acc); pred(next)) {
+						acc = next;
+						r--;
+					}
+				}
+				return r + 1 - sz;
+			}
+			acc = combinator(tree[r], acc);
+		} while (!std::has_single_bit(r));
+		return 0;
+	}
+};
+
+/**
+ * B-ary segment tree for read-heavy workloads. The B children of every node
+ * are stored contiguously level by level, so a query scans at most two
+ * partial blocks per level and touches O(log_B n) cache lines. By default a
+ * block fills one 64-byte cache line. The block scans are plain left folds,
+ * which keeps the tree order preserving.
+ */
+template <class T, class U = T, class CombineOp = std::plus<>,
+          class UpdateOp = std::plus<>,
+          size_t B = std::max<size_t>(64 / sizeof(T), 2)>
+class wide_segment_tree {
+	static_assert(B >= 2, "wide_segment_tree needs at least two children");
+
+	size_t n;
+	std::vector<size_t> offset;
+	std::vector<T> tree;
+	T identity;
+	CombineOp combinator;
+	UpdateOp updater;
+
+	T fold(const T *first, const T *last) const {
+		T res = identity;
+		for (; first != last; ++first)
+			res = combinator(res, *first);
+		return res;
+	}
+
+  public:
+	explicit wide_segment_tree(
+	    const std::vector<T> &init,
+	    const T &identity = fn::default_identity<CombineOp, T>(),
+	    CombineOp combinator = {}, UpdateOp updater = {})
+	    : n(init.size()), identity(identity), combinator(combinator),
+	      updater(updater) {
+		size_t total = 0;
+		for (size_t len = n;; len = (len + B - 1) / B) {
+			offset.push_back(total);
+			total += (len + B - 1) / B * B;
+			if (len <= 1)
+				break;
+		}
+		tree.assign(total, identity);
+		std::copy(init.begin(), init.end(), tree.begin());
+		for (size_t k = 1, len = n; k < offset.size(); k++) {
+			len = (len + B - 1) / B;
+			const T *below = tree.data() + offset[k - 1];
+			for (size_t i = 0; i < len; i++)
+				tree[offset[k] + i] = fold(below + i * B, below + (i + 1) * B);
+		}
+	}
+	explicit wide_segment_tree(
+	    size_t n, const T &init = {},
+	    const T &identity = fn::default_identity<CombineOp, T>(),
+	    CombineOp combinator = {}, UpdateOp updater = {})
+	    : wide_segment_tree(std::vector<T>(n, init), identity, combinator,
+	                        updater) {}
+
+	size_t size() const { return n; }
+
+	void modify(size_t p, const U &val) {
+		tree[p] = updater(tree[p], val);
+		for (size_t k = 1; k < offset.size(); k++) {
+			const T *block = tree.data() + offset[k - 1] + p / B * B;
+			p /= B;
+			tree[offset[k] + p] = fold(block, block + B);
+		}
+	}
+
+	T query(size_t l) const { return tree[l]; }
+
+	T query(size_t l, size_t r) const {
+		T resl = identity, resr = identity;
+		r++;
+		for (size_t k = 0;; k++) {
+			const T *level = tree.data() + offset[k];
+			size_t lb = (l + B - 1) / B * B, rb = r / B * B;
+			if (lb >= rb) {
+				resl = combinator(resl, fold(level + l, level + r));
+				break;
+			}
+			resl = combinator(resl, fold(level + l, level + lb));
+			resr = combinator(fold(level + rb, level + r), resr);
+			l = lb / B, r = rb / B;
+		}
+		return combinator(resl, resr);
+	}
+};
+
 template <class T, class U = T, class CombineOp = std::plus<>,
           class UpdateOp = std::plus<>, class CombineUpdateOp = UpdateOp,
           class UpdateLenOp = fn::noop>
 class lazy_segment_tree {
+	using tag = fn::lazy_tag<T, U, UpdateOp, CombineUpdateOp, UpdateLenOp>;
+
 	size_t n, h;
 	std::vector<T> tree;
-	std::vector<std::optional<U>> lazy;
+	std::vector<typename tag::type> lazy;
 	CombineOp combinator;
 	UpdateOp updater;
 	CombineUpdateOp lazyCombinator;
@@ -80,15 +359,14 @@ class lazy_segment_tree {
 
 	void calc(size_t p, size_t len) {
 		tree[p] = combinator(tree[p << 1], tree[p << 1 | 1]);
-		if (lazy[p]) {
-			tree[p] = updater(tree[p], updaterLen(*lazy[p], len));
-		}
+		if (auto val = tag::get(lazy[p]))
+			tree[p] = updater(tree[p], updaterLen(*val, len));
 	}
 
 	void apply(size_t p, const U &val, size_t len) {
 		tree[p] = updater(tree[p], updaterLen(val, len));
 		if (p < n)
-			lazy[p] = lazy[p].has_value() ? lazyCombinator(*lazy[p], val) : val;
+			tag::compose(lazy[p], val, lazyCombinator);
 	}
 
 	void build(size_t p) {
@@ -101,10 +379,10 @@ class lazy_segment_tree {
 		int s = h, len = 1 << (h - 1);
 		for (p += n; s > 0; s--, len >>= 1) {
 			int i = p >> s;
-			if (lazy[i]) {
-				apply(i << 1, *lazy[i], len);
-				apply(i << 1 | 1, *lazy[i], len);
-				lazy[i].reset();
+			if (auto val = tag::get(lazy[i])) {
+				apply(i << 1, *val, len);
+				apply(i << 1 | 1, *val, len);
+				lazy[i] = tag::empty();
 			}
 		}
 	}
@@ -114,7 +392,8 @@ class lazy_segment_tree {
 	                           CombineOp combinator = {}, UpdateOp updater = {},
 	                           CombineUpdateOp lazyCombinator = {},
 	                           UpdateLenOp updaterLen = {})
-	    : n(init.size()), h(std::bit_width(n)), tree(n), lazy(n + n),
+	    : n(init.size()), h(std::bit_width(n)), tree(n),
+	      lazy(n + n, tag::empty()),
 	      combinator(combinator), updater(updater),
 	      lazyCombinator(lazyCombinator), updaterLen(updaterLen) {
 		copy(init.begin(), init.end(), back_inserter(tree));
@@ -145,6 +424,16 @@ class lazy_segment_tree {
 	T query(int l, int r) {
 		push(l);
 		push(r);
+		if constexpr (fn::monoid<CombineOp, T>) {
+			T resl = fn::identity_element<CombineOp, T>::value(), resr = resl;
+			for (l += n, r += n + 1; l < r; l >>= 1, r >>= 1) {
+				if (l & 1)
+					resl = combinator(resl, tree[l++]);
+				if (r & 1)
+					resr = combinator(tree[--r], resr);
+			}
+			return combinator(resl, resr);
+		}
 		std::optional<T> resl, resr;
 		for (l += n, r += n + 1; l < r; l >>= 1, r >>= 1) {
 			if (l & 1)
@@ -1,12 +1,19 @@
 #include "segment_tree.hpp"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include "functional.hpp"
 #include "modint.hpp"
+#include "sparse_table.hpp"
 
 TEST_CASE("segment_tree: range sum query, point add update", "[segment_tree]") {
 	std::vector<int> v{3, 2, 8, 5};
@@ -97,6 +104,297 @@ TEST_CASE("segment_tree check order preserving: range leftmost query, point "
 	REQUIRE(st.query(1, 2) == 10);
 }
 
+TEST_CASE("segment_tree: batch modify", "[segment_tree]") {
+	SECTION("basic") {
+		std::vector<int> v{3, 2, 8, 5, 1};
+		segment_tree st(v);
+		std::vector<std::pair<size_t, int>> updates{{1, 10}, {4, 2}, {1, 1}};
+		st.modify_batch(updates);
+		REQUIRE(st.query(0, 4) == 32);
+		REQUIRE(st.query(1, 1) == 13);
+		REQUIRE(st.query(3, 4) == 8);
+		REQUIRE(st.query(0, 0) == 3);
+		st.modify_batch({});
+		REQUIRE(st.query(0, 4) == 32);
+	}
+	SECTION("random cross-check with non-commutative combinator") {
+		for (int n : {1, 2, 7, 16, 37}) {
+			std::mt19937 rng(n);
+			auto rnd = [&](unsigned bound) { return rng() % bound; };
+			std::vector<std::string> v(n);
+			for (auto &x : v)
+				x = std::string(1, 'a' + rnd(26));
+			segment_tree<std::string, std::string, std::plus<>, fn::assign>
+			    st(v), batched(v);
+			for (int it = 0; it < 30; it++) {
+				std::vector<std::pair<size_t, std::string>> updates;
+				for (int k = rnd(10); k >= 0; k--) {
+					updates.emplace_back(rnd(n), std::string(1, 'a' + rnd(26)));
+					st.modify(updates.back().first, updates.back().second);
+				}
+				batched.modify_batch(updates);
+				std::vector<std::pair<size_t, size_t>> queries;
+				for (int k = rnd(20); k >= 0; k--) {
+					size_t l = rnd(n), r = rnd(n);
+					queries.emplace_back(std::min(l, r), std::max(l, r));
+				}
+				for (auto [l, r] : queries)
+					REQUIRE(batched.query(l, r) == st.query(l, r));
+			}
+		}
+	}
+}
+
+TEST_CASE("segment_tree batch modify benchmark",
+          "[segment_tree][.][benchmark]") {
+	const int n = 1 << 20, k = 1 << 14;
+	std::vector<std::pair<size_t, int>> updates(k);
+	std::mt19937 rng(0);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	for (auto &[p, val] : updates)
+		p = rnd(n), val = rnd(1000);
+	segment_tree<int> st(n);
+	BENCHMARK("modify") {
+		for (auto [p, val] : updates)
+			st.modify(p, val);
+		return st.query(0, n - 1);
+	};
+	BENCHMARK("modify_batch") {
+		st.modify_batch(updates);
+		return st.query(0, n - 1);
+	};
+}
+
+TEST_CASE("segment_tree: parallel build matches serial build",
+          "[segment_tree]") {
+	// not even associative, so equal answers need identical trees
+	struct poly_hash {
+		unsigned long long operator()(unsigned long long a,
+		                              unsigned long long b) const {
+			return a * 1'000'003 + b;
+		}
+	};
+	for (int n : {1, 3, 200'000, 262'144, 300'001}) {
+		std::vector<unsigned long long> v(n);
+		std::iota(v.begin(), v.end(), 1);
+		segment_tree<unsigned long long, unsigned long long, poly_hash> serial(
+		    v, {}, {}, 1);
+		segment_tree<unsigned long long, unsigned long long, poly_hash>
+		    parallel(v, {}, {}, 4);
+		for (int i = 0; i < 1'000; i++) {
+			size_t l = size_t(i) * 7919 % n, r = size_t(i) * 104'729 % n;
+			if (l > r)
+				std::swap(l, r);
+			REQUIRE(serial.query(l, r) == parallel.query(l, r));
+		}
+	}
+}
+
+TEST_CASE("segment_tree parallel build benchmark",
+          "[segment_tree][.][benchmark]") {
+	std::vector<long long> v(1 << 21);
+	std::iota(v.begin(), v.end(), 0);
+	BENCHMARK("serial") {
+		return segment_tree<long long>(v, {}, {}, 1).query(0, v.size() - 1);
+	};
+	BENCHMARK("parallel") {
+		return segment_tree<long long>(v, {}, {}, default_thread_count())
+		    .query(0, v.size() - 1);
+	};
+}
+
+TEST_CASE("padded_segment_tree: non-commutative concatenation",
+          "[segment_tree]") {
+	std::vector<std::string> v{"a", "b", "c", "d", "e"};
+	padded_segment_tree<std::string, std::string, std::plus<>, fn::assign> st(
+	    v, "");
+	REQUIRE(st.size() == 5);
+	REQUIRE(st.query(0, 4) == "abcde");
+	REQUIRE(st.query(1, 3) == "bcd");
+	REQUIRE(st.query(3, 4) == "de");
+	st.modify(2, "xy");
+	REQUIRE(st.query(2) == "xy");
+	REQUIRE(st.query(0, 4) == "abxyde");
+	REQUIRE(st.query(2, 3) == "xyd");
+}
+
+TEST_CASE("padded_segment_tree: max_right and min_left", "[segment_tree]") {
+	SECTION("prefix sums") {
+		std::vector<int> v{3, 2, 8, 5, 1};
+		padded_segment_tree st(v);
+		auto at_most = [](int k) { return [k](int x) { return x <= k; }; };
+		REQUIRE(st.max_right(0, at_most(2)) == 0);
+		REQUIRE(st.max_right(0, at_most(5)) == 2);
+		REQUIRE(st.max_right(0, at_most(100)) == 5);
+		REQUIRE(st.max_right(1, at_most(10)) == 3);
+		REQUIRE(st.max_right(5, at_most(0)) == 5);
+		REQUIRE(st.min_left(5, at_most(6)) == 3);
+		REQUIRE(st.min_left(3, at_most(10)) == 1);
+		REQUIRE(st.min_left(3, at_most(100)) == 0);
+		REQUIRE(st.min_left(0, at_most(0)) == 0);
+		st.modify(2, -8);
+		REQUIRE(st.max_right(0, at_most(5)) == 3);
+		REQUIRE(st.max_right(0, at_most(10)) == 4);
+	}
+	SECTION("default identity of minimum") {
+		std::vector<int> v{3, 2, 8, 5, 1};
+		padded_segment_tree<int, int, fn::minimum<>> st(v);
+		REQUIRE(st.query(0, 2) == 2);
+		REQUIRE(st.max_right(0, [](int x) { return x >= 2; }) == 4);
+		REQUIRE(st.min_left(4, [](int x) { return x >= 3; }) == 2);
+	}
+	SECTION("custom operation with an explicit identity") {
+		// no fn::identity_element, so the identity must be passed
+		struct min_op {
+			int operator()(int a, int b) const { return std::min(a, b); }
+		};
+		STATIC_REQUIRE(!fn::monoid<min_op, int>);
+		std::vector<int> v{3, 2, 8, 5, 1};
+		padded_segment_tree<int, int, min_op> st(v, 1e9);
+		REQUIRE(st.query(2, 3) == 5);
+		REQUIRE(st.max_right(0, [](int x) { return x >= 2; }) == 4);
+		wide_segment_tree<int, int, min_op, fn::assign, 2> wst(v, 1e9);
+		REQUIRE(wst.query(2, 3) == 5);
+		REQUIRE(wst.query(0, 4) == 1);
+	}
+	SECTION("random cross-check with maximum") {
+		const int n = 37, inf = 1e9;
+		std::mt19937 rng(7);
+		auto rnd = [&](unsigned bound) { return rng() % bound; };
+		std::vector<int> v(n);
+		for (auto &x : v)
+			x = rnd(100);
+		padded_segment_tree<int, int, fn::maximum<>, fn::assign> st(v, -inf);
+		for (int it = 0; it < 300; it++) {
+			int p = rnd(n), k = rnd(100);
+			st.modify(p, v[p] = rnd(100));
+			auto pred = [k](int x) { return x < k; };
+			int l = rnd(n + 1), r = l;
+			while (r < n && v[r] < k)
+				r++;
+			REQUIRE(st.max_right(l, pred) == size_t(r));
+			r = rnd(n + 1), l = r;
+			while (l > 0 && v[l - 1] < k)
+				l--;
+			REQUIRE(st.min_left(r, pred) == size_t(l));
+		}
+	}
+}
+
+TEST_CASE("wide_segment_tree: range queries, point updates",
+          "[segment_tree]") {
+	SECTION("range sum query, point add update") {
+		std::vector<int> v{3, 2, 8, 5};
+		wide_segment_tree st(v);
+		REQUIRE(st.query(0, 1) == 5);
+		REQUIRE(st.query(1, 3) == 15);
+		st.modify(1, 10);
+		REQUIRE(st.query(1, 3) == 25);
+		REQUIRE(st.query(0, 0) == 3);
+		REQUIRE(st.query(1) == 12);
+	}
+	SECTION("non-commutative concatenation") {
+		std::vector<std::string> v{"a", "b", "c", "d", "e", "f", "g"};
+		wide_segment_tree<std::string, std::string, std::plus<>, fn::assign,
+		                  2>
+		    st(v, "");
+		REQUIRE(st.query(0, 6) == "abcdefg");
+		REQUIRE(st.query(1, 5) == "bcdef");
+		st.modify(3, "xy");
+		REQUIRE(st.query(2, 4) == "cxye");
+	}
+	SECTION("random cross-check") {
+		const int n = 300, inf = std::numeric_limits<int>::max();
+		std::mt19937 rng(11);
+		auto rnd = [&](unsigned bound) { return rng() % bound; };
+		std::vector<int> v(n);
+		for (auto &x : v)
+			x = rnd(1000);
+		wide_segment_tree<int, int, fn::minimum<>, fn::assign, 4> mn(v, inf);
+		// one cache line per block
+		wide_segment_tree<int, int, fn::minimum<>, fn::assign> mn_line(v, inf);
+		wide_segment_tree<int, int, std::plus<>, fn::assign> sum(v);
+		std::vector<long long> w(v.begin(), v.end());
+		wide_segment_tree<long long, long long, fn::maximum<>, fn::assign> mx(
+		    w, std::numeric_limits<long long>::lowest());
+		for (int it = 0; it < 500; it++) {
+			int p = rnd(n);
+			v[p] = rnd(1000);
+			w[p] = v[p];
+			mn.modify(p, v[p]);
+			mn_line.modify(p, v[p]);
+			sum.modify(p, v[p]);
+			mx.modify(p, w[p]);
+			int l = rnd(n), r = rnd(n);
+			if (l > r)
+				std::swap(l, r);
+			int expected_min =
+			    *std::min_element(v.begin() + l, v.begin() + r + 1);
+			REQUIRE(mn.query(l, r) == expected_min);
+			REQUIRE(mn_line.query(l, r) == expected_min);
+			REQUIRE(sum.query(l, r) ==
+			        std::accumulate(v.begin() + l, v.begin() + r + 1, 0));
+			REQUIRE(mx.query(l, r) ==
+			        *std::max_element(w.begin() + l, w.begin() + r + 1));
+		}
+	}
+}
+
+TEST_CASE("segment tree range min query benchmark",
+          "[segment_tree][.][benchmark]") {
+	const int n = 1 << 17, q = 1 << 17,
+	          inf = std::numeric_limits<int>::max();
+	std::vector<int> v(n);
+	std::vector<std::pair<int, int>> queries(q);
+	std::mt19937 rng(0);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	for (auto &x : v)
+		x = rnd(1'000'000'000);
+	for (auto &[l, r] : queries) {
+		l = rnd(n), r = rnd(n);
+		if (l > r)
+			std::swap(l, r);
+	}
+	auto run = [&](const auto &st) {
+		long long res = 0;
+		for (auto [l, r] : queries)
+			res += st.query(l, r);
+		return res;
+	};
+	segment_tree<int, int, fn::minimum<>> st(v);
+	padded_segment_tree<int, int, fn::minimum<>> pst(v, inf);
+	wide_segment_tree<int, int, fn::minimum<>, fn::assign, 8> wst8(v, inf);
+	wide_segment_tree<int, int, fn::minimum<>, fn::assign> wst16(v, inf);
+	sparse_table<int, fn::minimum<>> sp(v);
+	BENCHMARK("segment_tree") { return run(st); };
+	BENCHMARK("padded_segment_tree") { return run(pst); };
+	BENCHMARK("wide_segment_tree B = 8") { return run(wst8); };
+	BENCHMARK("wide_segment_tree B = 16") { return run(wst16); };
+	BENCHMARK("sparse_table") { return run(sp); };
+}
+
+TEST_CASE("wide_segment_tree point update benchmark",
+          "[segment_tree][.][benchmark]") {
+	const int n = 1 << 20, q = 1 << 18;
+	std::vector<int> v(n);
+	std::vector<std::pair<int, int>> updates(q);
+	std::mt19937 rng(0);
+	for (auto &x : v)
+		x = rng() % 1'000'000'000;
+	for (auto &[p, x] : updates)
+		p = rng() % n, x = rng() % 1'000'000'000;
+	auto run = [&](auto &st) {
+		for (auto [p, x] : updates)
+			st.modify(p, x);
+		return st.query(0, n - 1);
+	};
+	segment_tree<int, int, fn::minimum<>, fn::assign> st(v);
+	wide_segment_tree<int, int, fn::minimum<>, fn::assign> wst(
+	    v, std::numeric_limits<int>::max());
+	BENCHMARK("segment_tree") { return run(st); };
+	BENCHMARK("wide_segment_tree B = 16") { return run(wst); };
+}
+
 TEST_CASE("lazy_segment_tree: range max query, range add update",
           "[segment_tree]") {
 	std::vector<int> v{3, 2, 8, 5};
@@ -165,6 +463,70 @@ TEST_CASE("lazy_segment_tree: range product query, range product update",
 	REQUIRE(st.query(1, 3) == 10);
 }
 
+TEST_CASE("lazy_segment_tree: range sum query, range add update",
+          "[segment_tree]") {
+	// same operation without an identity, so tags are std::optional
+	struct add : std::plus<> {};
+	const int n = 50;
+	std::mt19937 rng(3);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	std::vector<long long> v(n);
+	for (auto &x : v)
+		x = rnd(100);
+	lazy_segment_tree<long long, long long, std::plus<>, std::plus<>,
+	                  std::plus<>, std::multiplies<>>
+	    st(v);
+	lazy_segment_tree<long long, long long, std::plus<>, add, add,
+	                  std::multiplies<>>
+	    opt(v);
+	for (int it = 0; it < 300; it++) {
+		int l = rnd(n), r = rnd(n), val = rnd(100);
+		if (l > r)
+			std::swap(l, r);
+		st.modify(l, r, val);
+		opt.modify(l, r, val);
+		for (int i = l; i <= r; i++)
+			v[i] += val;
+		l = rnd(n), r = rnd(n);
+		if (l > r)
+			std::swap(l, r);
+		auto expected = std::accumulate(v.begin() + l, v.begin() + r + 1, 0LL);
+		REQUIRE(st.query(l, r) == expected);
+		REQUIRE(opt.query(l, r) == expected);
+	}
+}
+
+TEST_CASE("lazy_segment_tree range add range sum benchmark",
+          "[segment_tree][.][benchmark]") {
+	struct add : std::plus<> {};
+	const int n = 1 << 17, q = 1 << 17;
+	std::vector<std::tuple<int, int, long long>> ops(q);
+	std::mt19937 rng(0);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	for (auto &[l, r, val] : ops) {
+		l = rnd(n), r = rnd(n), val = rnd(1000);
+		if (l > r)
+			std::swap(l, r);
+	}
+	auto run = [&](auto st) {
+		long long res = 0;
+		for (auto [l, r, val] : ops) {
+			st.modify(l, r, val);
+			res += st.query(l, r);
+		}
+		return res;
+	};
+	BENCHMARK("identity tags") {
+		return run(lazy_segment_tree<long long, long long, std::plus<>,
+		                             std::plus<>, std::plus<>,
+		                             std::multiplies<>>(n));
+	};
+	BENCHMARK("optional tags") {
+		return run(lazy_segment_tree<long long, long long, std::plus<>, add,
+		                             add, std::multiplies<>>(n));
+	};
+}
+
 TEST_CASE("lazy_segment_tree: range mxss query, range assignment update",
           "[segment_tree]") {
 	struct mxss_node {
@@ -6,65 +6,272 @@
 #ifndef SPARSE_TABLE_HPP
 #define SPARSE_TABLE_HPP
 
+#include <algorithm>
 #include <bit>
+#include <concepts>
+#include <cstdint>
+#include <functional>
 #include <vector>
 
-template <class T, class Op = std::bit_or<>> class sparse_table {
+#include "functional.hpp"
+#include "parallel.hpp"
+
+// start of every level of a flat sparse table over n elements with m levels,
+// level j holds the n - 2^j + 1 blocks of length 2^j
+inline std::vector<size_t> sparse_table_level_offsets(size_t n, size_t m) {
+	std::vector<size_t> offset(m + 1);
+	for (size_t j = 0; j < m; j++)
+		offset[j + 1] = offset[j] + n + 1 - (size_t{1} << j);
+	return offset;
+}
+
+/**
+ * All levels live in one allocation, level j holds the n - 2^j + 1 blocks of
+ * length 2^j and starts at offset[j]. Queries combine two overlapping blocks,
+ * so Op must be idempotent, use disjoint_sparse_table for other associative
+ * operations.
+ */
+template <class T, class Op = std::bit_or<>>
+    requires fn::is_idempotent<Op>
+class sparse_table {
 	size_t n, m;
-	std::vector<std::vector<T>> dp;
+	std::vector<size_t> offset;
+	std::vector<T> dp;
 	Op op;
 
+	// levels shorter than this are built by the calling thread
+	static constexpr size_t serial_threshold = 1 << 16;
+
+	const T &at(size_t j, size_t i) const { return dp[offset[j] + i]; }
+
   public:
-	sparse_table(const std::vector<T> &init, const Op &comb = {})
-	    : n(init.size()), m(std::bit_width(n)), dp(m, std::vector<T>(n)),
-	      op(comb) {
-		dp[0] = init;
+	/**
+	 * Each level only reads the level below it, so with threads > 1 long
+	 * levels are split across threads and give the same table as a serial
+	 * build. Op must then be safe to call concurrently.
+	 */
+	sparse_table(const std::vector<T> &init, const Op &comb = {},
+	             unsigned threads = 1)
+	    : n(init.size()), m(std::bit_width(n)),
+	      offset(sparse_table_level_offsets(n, m)), dp(init), op(comb) {
+		dp.resize(offset[m]);
 		for (size_t j = 1; j < m; j++) {
-			for (size_t i = 0; i + (1 << j) <= n; i++) {
-				dp[j][i] = op(dp[j - 1][i], dp[j - 1][i + (1 << (j - 1))]);
-			}
+			auto calc = [this, j](size_t lo, size_t hi) {
+				size_t half = size_t{1} << (j - 1);
+				for (size_t i = lo; i < hi; i++)
+					dp[offset[j] + i] = op(at(j - 1, i), at(j - 1, i + half));
+			};
+			size_t len = offset[j + 1] - offset[j];
+			if (threads > 1 && len >= serial_threshold)
+				parallel_for(0, len, calc, threads);
+			else
+				calc(0, len);
 		}
 	}
 
-	T query(size_t l) const { return dp[0][l]; }
+	T query(size_t l) const { return dp[l]; }
 
 	T query(size_t l, size_t r) const {
 		int j = std::bit_width(r - l + 1) - 1;
-		return op(dp[j][l], dp[j][r + 1 - (1 << j)]);
+		return op(at(j, l), at(j, r + 1 - (1 << j)));
 	}
 };
 
-template <class T, class Op = std::bit_or<>> class sparse_table_matrix {
-	size_t nx, ny, mx;
-	std::vector<std::vector<sparse_table<T, Op>>> dp;
+/**
+ * Two dimensional sparse table in one allocation. Every x block of every
+ * level stores a complete one dimensional table over y. Op must be
+ * idempotent as in sparse_table.
+ */
+template <class T, class Op = std::bit_or<>>
+    requires fn::is_idempotent<Op>
+class sparse_table_matrix {
+	size_t nx, ny, mx, my;
+	std::vector<size_t> offset_x, offset_y;
+	std::vector<T> dp;
 	Op op;
 
+	// start of the y table of block i on x level j
+	size_t row(size_t j, size_t i) const {
+		return (offset_x[j] + i) * offset_y[my];
+	}
+
+	T query_row(size_t base, size_t l, size_t r) const {
+		int j = std::bit_width(r - l + 1) - 1;
+		return op(dp[base + offset_y[j] + l],
+		          dp[base + offset_y[j] + r + 1 - (1 << j)]);
+	}
+
   public:
 	sparse_table_matrix(const std::vector<std::vector<T>> &init,
 	                    const Op &comb = {})
-	    : nx(init.size()), ny(init[0].size()), mx(std::bit_width(nx)), dp(mx),
-	      op(comb) {
-		dp[0].reserve(nx);
+	    : nx(init.size()), ny(init[0].size()), mx(std::bit_width(nx)),
+	      my(std::bit_width(ny)),
+	      offset_x(sparse_table_level_offsets(nx, mx)),
+	      offset_y(sparse_table_level_offsets(ny, my)),
+	      dp(offset_x[mx] * offset_y[my], init[0][0]), op(comb) {
 		for (size_t i = 0; i < nx; i++) {
-			dp[0].emplace_back(init[i], comb);
+			size_t base = row(0, i);
+			std::copy(init[i].begin(), init[i].end(), dp.begin() + base);
+			for (size_t k = 1; k < my; k++) {
+				size_t half = size_t{1} << (k - 1);
+				for (size_t y = 0; y + (size_t{1} << k) <= ny; y++) {
+					dp[base + offset_y[k] + y] =
+					    op(dp[base + offset_y[k - 1] + y],
+					       dp[base + offset_y[k - 1] + y + half]);
+				}
+			}
 		}
+		// a y table of a longer x block combines two shorter ones entrywise
 		for (size_t j = 1; j < mx; j++) {
-			dp[j].reserve(nx);
-			for (size_t i = 0; i + (1 << j) <= nx; i++) {
-				std::vector<T> w(ny);
-				for (size_t k = 0; k < ny; k++) {
-					w[k] = op(dp[j - 1][i].query(k),
-					          dp[j - 1][i + (1 << (j - 1))].query(k));
-				}
-				dp[j].emplace_back(w, comb);
+			size_t half = size_t{1} << (j - 1);
+			for (size_t i = 0; i + (size_t{1} << j) <= nx; i++) {
+				size_t dst = row(j, i), lo = row(j - 1, i),
+				       hi = row(j - 1, i + half);
+				for (size_t k = 0; k < offset_y[my]; k++)
+					dp[dst + k] = op(dp[lo + k], dp[hi + k]);
 			}
 		}
 	}
 
 	T query(size_t lx, size_t ly, size_t rx, size_t ry) const {
 		int j = std::bit_width(rx - lx + 1) - 1;
-		return op(dp[j][lx].query(ly, ry),
-		          dp[j][rx + 1 - (1 << j)].query(ly, ry));
+		return op(query_row(row(j, lx), ly, ry),
+		          query_row(row(j, rx + 1 - (1 << j)), ly, ry));
+	}
+};
+
+/**
+ * Sparse table over blocks of 32 elements with O(n) memory for idempotent
+ * operations. Queries crossing a block boundary combine a block suffix, the
+ * sparse table over whole blocks and a block prefix. Queries inside one
+ * block take O(1) through a bitmask of the running minima for selective
+ * operations like fn::minimum, and scan the block otherwise.
+ */
+template <class T, class Op = std::bit_or<>>
+    requires fn::is_idempotent<Op>
+class block_sparse_table {
+	static constexpr size_t block = 32;
+	static constexpr bool use_masks =
+	    fn::is_selective<Op> && std::equality_comparable<T>;
+
+	size_t n;
+	std::vector<T> values, prefix, suffix;
+	std::vector<uint32_t> masks;
+	sparse_table<T, Op> blocks;
+	Op op;
+
+	static std::vector<T> block_totals(const std::vector<T> &init,
+	                                   const Op &op) {
+		std::vector<T> totals;
+		totals.reserve((init.size() + block - 1) / block);
+		for (size_t i = 0; i < init.size(); i++) {
+			if (i % block == 0)
+				totals.push_back(init[i]);
+			else
+				totals.back() = op(totals.back(), init[i]);
+		}
+		return totals;
+	}
+
+	T query_block(size_t l, size_t r) const {
+		if constexpr (use_masks) {
+			size_t start = l - l % block;
+			uint32_t m = masks[r] & (~uint32_t{0} << (l - start));
+			return values[start + std::countr_zero(m)];
+		} else {
+			T res = values[l];
+			for (size_t i = l + 1; i <= r; i++)
+				res = op(res, values[i]);
+			return res;
+		}
+	}
+
+  public:
+	block_sparse_table(const std::vector<T> &init, const Op &comb = {})
+	    : n(init.size()), values(init), prefix(init), suffix(init),
+	      blocks(block_totals(init, comb), comb), op(comb) {
+		if (n == 0)
+			return;
+		for (size_t i = 1; i < n; i++)
+			if (i % block != 0)
+				prefix[i] = op(prefix[i - 1], prefix[i]);
+		for (size_t i = n - 1; i-- > 0;)
+			if ((i + 1) % block != 0)
+				suffix[i] = op(suffix[i], suffix[i + 1]);
+		if constexpr (use_masks) {
+			// bit k of masks[i] is set while the k-th element of the block
+			// wins against every later element up to i
+			masks.resize(n);
+			uint32_t stack = 0;
+			for (size_t i = 0; i < n; i++) {
+				size_t start = i - i % block;
+				if (i == start)
+					stack = 0;
+				while (stack) {
+					size_t top = start + std::bit_width(stack) - 1;
+					if (!(op(values[top], values[i]) == values[i]))
+						break;
+					stack ^= uint32_t{1} << (top - start);
+				}
+				masks[i] = stack |= uint32_t{1} << (i - start);
+			}
+		}
+	}
+
+	T query(size_t l) const { return values[l]; }
+
+	T query(size_t l, size_t r) const {
+		size_t bl = l / block, br = r / block;
+		if (bl == br)
+			return query_block(l, r);
+		T res = op(suffix[l], prefix[r]);
+		if (bl + 1 < br)
+			res = op(res, blocks.query(bl + 1, br - 1));
+		return res;
+	}
+};
+
+/**
+ * Disjoint sparse table, O(1) queries for any associative operation. Level h
+ * cuts the array into blocks of 2^h elements and stores, around the middle
+ * of each block, the folds towards the middle. A query [l, r] is split at the
+ * middle of the smallest block containing both ends, the level of which is
+ * the highest bit where l and r differ. Operands keep their order, so
+ * non-commutative operations such as matrix products work as well.
+ */
+template <class T, class Op = std::plus<>> class disjoint_sparse_table {
+	size_t n, m;
+	std::vector<T> dp;
+	Op op;
+
+	// level 0 holds the values, level h starts at h * n
+	const T &at(size_t h, size_t i) const { return dp[h * n + i]; }
+
+  public:
+	disjoint_sparse_table(const std::vector<T> &init, const Op &comb = {})
+	    : n(init.size()), m(n > 1 ? std::bit_width(n - 1) : 0), op(comb) {
+		dp.reserve((m + 1) * n);
+		for (size_t h = 0; h <= m; h++)
+			dp.insert(dp.end(), init.begin(), init.end());
+		for (size_t h = 1; h <= m; h++) {
+			T *level = dp.data() + h * n;
+			size_t half = size_t{1} << (h - 1);
+			for (size_t mid = half; mid < n; mid += half << 1) {
+				for (size_t i = mid - 1; i-- > mid - half;)
+					level[i] = op(level[i], level[i + 1]);
+				for (size_t i = mid + 1; i < std::min(mid + half, n); i++)
+					level[i] = op(level[i - 1], level[i]);
+			}
+		}
+	}
+
+	T query(size_t l) const { return dp[l]; }
+
+	T query(size_t l, size_t r) const {
+		if (l == r)
+			return dp[l];
+		size_t h = std::bit_width(l ^ r);
+		return op(at(h, l), at(h, r));
 	}
 };
 
@@ -1,10 +1,17 @@
 #include "functional.hpp"
+#include "matrix.hpp"
+#include "modint.hpp"
 #include "sparse_table.hpp"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
 #include <functional>
 #include <numeric>
+#include <random>
+#include <string>
+#include <type_traits>
 
 TEST_CASE("sparse_table with bitwise or", "[sparse_table]") {
 	std::vector<int> v{3, 2, 8, 5};
@@ -33,6 +40,61 @@ TEST_CASE("sparse_table with minimum index", "[sparse_table]") {
 	REQUIRE(st.query(2, 3) == 3);
 }
 
+template <class Op>
+concept sparse_table_op = requires { typename sparse_table<int, Op>; };
+
+struct custom_min {
+	using is_idempotent = std::true_type;
+	int operator()(int a, int b) const { return std::min(a, b); }
+};
+
+TEST_CASE("sparse_table with custom idempotent operation", "[sparse_table]") {
+	STATIC_REQUIRE(sparse_table_op<custom_min>);
+	STATIC_REQUIRE(!sparse_table_op<std::plus<>>);
+	std::vector<int> v{3, 2, 8, 5, 1, 7, 4};
+	sparse_table<int, custom_min> st(v);
+	for (size_t l = 0; l < v.size(); l++)
+		for (size_t r = l; r < v.size(); r++)
+			REQUIRE(st.query(l, r) ==
+			        *std::min_element(v.begin() + l, v.begin() + r + 1));
+	std::vector<std::vector<int>> w{{3, 2, 8}, {1, 2, 3}, {5, 6, 7}};
+	sparse_table_matrix<int, custom_min> stm(w);
+	REQUIRE(stm.query(0, 0, 2, 2) == 1);
+	REQUIRE(stm.query(0, 1, 2, 2) == 2);
+	REQUIRE(stm.query(2, 1, 2, 2) == 6);
+}
+
+TEST_CASE("sparse_table parallel build matches serial build",
+          "[sparse_table]") {
+	std::vector<long long> v(300'001);
+	std::mt19937 rng(1);
+	for (auto &x : v)
+		x = rng() % 1'000'000;
+	sparse_table<long long, fn::maximum<>> mx(v, {}, 1), mx_par(v, {}, 4);
+	sparse_table<long long, fn::minimum<>> mn(v, {}, 1), mn_par(v, {}, 4);
+	for (int i = 0; i < 1'000; i++) {
+		size_t l = size_t(i) * 7919 % v.size();
+		size_t r = size_t(i) * 104'729 % v.size();
+		if (l > r)
+			std::swap(l, r);
+		REQUIRE(mx.query(l, r) == mx_par.query(l, r));
+		REQUIRE(mn.query(l, r) == mn_par.query(l, r));
+	}
+}
+
+TEST_CASE("sparse_table parallel build benchmark",
+          "[sparse_table][.][benchmark]") {
+	std::vector<int> v(1 << 19);
+	std::iota(v.begin(), v.end(), 0);
+	BENCHMARK("serial") {
+		return sparse_table<int, fn::minimum<>>(v, {}, 1).query(0, 100);
+	};
+	BENCHMARK("parallel") {
+		return sparse_table<int, fn::minimum<>>(v, {}, default_thread_count())
+		    .query(0, 100);
+	};
+}
+
 TEST_CASE("sparse_table matrix with bitwise or", "[sparse_table_matrix]") {
 	std::vector<std::vector<int>> v{{3, 2, 8, 5}, {1, 2, 3, 4}, {5, 16, 7, 8}};
 	sparse_table_matrix st(v);
@@ -68,3 +130,180 @@ TEST_CASE("sparse_table matrix with projection", "[sparse_table_matrix]") {
 	REQUIRE(st.query(1, 1, 1, 3) == 3);
 	REQUIRE(st.query(0, 1, 2, 3) == 7);
 }
+
+TEST_CASE("sparse_table matrix matches brute force", "[sparse_table_matrix]") {
+	std::mt19937 rng(8);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	const size_t nx = 7, ny = 13;
+	std::vector<std::vector<long long>> v(nx, std::vector<long long>(ny));
+	for (auto &row : v)
+		for (auto &x : row)
+			x = rnd(1000);
+	sparse_table_matrix<long long, fn::maximum<>> mx(v);
+	sparse_table_matrix<long long, fn::minimum<>> mn(v);
+	for (int it = 0; it < 500; it++) {
+		size_t lx = rnd(nx), rx = rnd(nx), ly = rnd(ny), ry = rnd(ny);
+		if (lx > rx)
+			std::swap(lx, rx);
+		if (ly > ry)
+			std::swap(ly, ry);
+		long long M = v[lx][ly], m = v[lx][ly];
+		for (size_t i = lx; i <= rx; i++)
+			for (size_t j = ly; j <= ry; j++)
+				M = std::max(M, v[i][j]), m = std::min(m, v[i][j]);
+		REQUIRE(mx.query(lx, ly, rx, ry) == M);
+		REQUIRE(mn.query(lx, ly, rx, ry) == m);
+	}
+}
+
+TEST_CASE("block_sparse_table matches brute force", "[sparse_table]") {
+	std::mt19937 rng(12);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	auto proj = [](int x) { return x % 7; };
+	for (size_t n : {1, 31, 32, 33, 100, 1'000}) {
+		std::vector<int> v(n);
+		for (auto &x : v)
+			x = rnd(1'000) + 1;
+		block_sparse_table<int, fn::minimum<>> mn(v);
+		block_sparse_table<int, fn::maximum<>> mx(v);
+		block_sparse_table<int, fn::gcd<>> gcd(v);
+		block_sparse_table<int, decltype(fn::minimum({}, proj))> mn_proj(
+		    v, fn::minimum({}, proj));
+		for (int it = 0; it < 1'000; it++) {
+			size_t l = rnd(n), r = rnd(n);
+			if (l > r)
+				std::swap(l, r);
+			auto first = v.begin() + l, last = v.begin() + r + 1;
+			int g = 0;
+			for (auto i = first; i != last; i++)
+				g = std::gcd(g, *i);
+			REQUIRE(mn.query(l, r) == *std::min_element(first, last));
+			REQUIRE(mx.query(l, r) == *std::max_element(first, last));
+			REQUIRE(gcd.query(l, r) == g);
+			REQUIRE(proj(mn_proj.query(l, r)) ==
+			        proj(*std::min_element(first, last, [&](int a, int b) {
+				        return proj(a) < proj(b);
+			        })));
+		}
+	}
+}
+
+TEST_CASE("block_sparse_table of an empty array", "[sparse_table]") {
+	block_sparse_table<int, fn::minimum<>> mn(std::vector<int>{});
+	block_sparse_table<int, fn::gcd<>> gcd(std::vector<int>{});
+	block_sparse_table<int, fn::minimum<>> one(std::vector<int>{4});
+	REQUIRE(one.query(0, 0) == 4);
+}
+
+TEST_CASE("block_sparse_table benchmark", "[sparse_table][.][benchmark]") {
+	const size_t n = 1 << 18, q = 1 << 16;
+	std::mt19937 rng(1);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	std::vector<int> v(n);
+	for (auto &x : v)
+		x = rnd(1'000'000);
+	std::vector<std::pair<size_t, size_t>> queries(q);
+	for (auto &[l, r] : queries) {
+		l = rnd(n), r = l + rnd(n - l);
+	}
+	BENCHMARK("sparse_table build") {
+		return sparse_table<int, fn::minimum<>>(v).query(0, 10);
+	};
+	BENCHMARK("block_sparse_table build") {
+		return block_sparse_table<int, fn::minimum<>>(v).query(0, 10);
+	};
+	sparse_table<int, fn::minimum<>> st(v);
+	block_sparse_table<int, fn::minimum<>> bst(v);
+	BENCHMARK("sparse_table query") {
+		long long res = 0;
+		for (auto [l, r] : queries)
+			res += st.query(l, r);
+		return res;
+	};
+	BENCHMARK("block_sparse_table query") {
+		long long res = 0;
+		for (auto [l, r] : queries)
+			res += bst.query(l, r);
+		return res;
+	};
+}
+
+TEST_CASE("disjoint_sparse_table with non-commutative operations",
+          "[sparse_table]") {
+	SECTION("string concatenation") {
+		std::vector<std::string> v;
+		for (char c = 'a'; c <= 'z'; c++)
+			v.emplace_back(1, c);
+		for (size_t n : {1, 2, 5, 16, 17, 26}) {
+			std::vector<std::string> w(v.begin(), v.begin() + n);
+			disjoint_sparse_table<std::string> dst(w);
+			for (size_t l = 0; l < n; l++) {
+				std::string expected;
+				for (size_t r = l; r < n; r++) {
+					expected += w[r];
+					REQUIRE(dst.query(l, r) == expected);
+				}
+			}
+		}
+	}
+	SECTION("matrix products") {
+		using mat = matrix<mint_1097>;
+		auto mul = [](const mat &a, const mat &b) { return matmul(a, b); };
+		std::vector<mat> v;
+		for (int i = 0; i < 20; i++) {
+			mat a(2, 2);
+			a(0, 0) = i + 1, a(0, 1) = 2 * i, a(1, 0) = 3, a(1, 1) = i * i;
+			v.push_back(a);
+		}
+		disjoint_sparse_table<mat, decltype(mul)> dst(v, mul);
+		for (size_t l = 0; l < v.size(); l++) {
+			mat expected = v[l];
+			for (size_t r = l; r < v.size(); r++) {
+				if (r > l)
+					expected = matmul(expected, v[r]);
+				mat res = dst.query(l, r);
+				for (size_t i = 0; i < 2; i++)
+					for (size_t j = 0; j < 2; j++)
+						REQUIRE(res(i, j) == expected(i, j));
+			}
+		}
+	}
+	SECTION("modint products") {
+		std::vector<mint_1097> v(100);
+		for (size_t i = 0; i < v.size(); i++)
+			v[i] = i * 7 + 3;
+		disjoint_sparse_table<mint_1097, std::multiplies<>> dst(v);
+		mint_1097 expected = 1;
+		for (size_t r = 10; r < v.size(); r++) {
+			expected *= v[r];
+			REQUIRE(dst.query(10, r) == expected);
+		}
+	}
+}
+
+TEST_CASE("disjoint_sparse_table benchmark", "[sparse_table][.][benchmark]") {
+	const size_t n = 1 << 18, q = 1 << 16;
+	std::mt19937 rng(1);
+	auto rnd = [&](unsigned bound) { return rng() % bound; };
+	std::vector<long long> v(n);
+	for (auto &x : v)
+		x = rnd(1'000'000);
+	std::vector<std::pair<size_t, size_t>> queries(q);
+	for (auto &[l, r] : queries) {
+		l = rnd(n), r = l + rnd(n - l);
+	}
+	sparse_table<long long, fn::minimum<>> st(v);
+	disjoint_sparse_table<long long, fn::minimum<>> dst(v);
+	BENCHMARK("sparse_table range min") {
+		long long res = 0;
+		for (auto [l, r] : queries)
+			res += st.query(l, r);
+		return res;
+	};
+	BENCHMARK("disjoint_sparse_table range min") {
+		long long res = 0;
+		for (auto [l, r] : queries)
+			res += dst.query(l, r);
+		return res;
+	};
+}
@@ -382,6 +382,8 @@ template <std::ranges::random_access_range R>
     requires std::ranges::sized_range<R>
 std::pair<std::vector<int>, std::vector<int>> build_suffix_array(R &&s) {
 	int n = std::ranges::size(s);
+	if (n == 0)
+		return {};
 	int m = *std::ranges::max_element(s) + 1;
 
 	// helper functions
@@ -533,7 +535,7 @@ template <class T> class suffix_array : public std::vector<int> {
 
 	class longest_common_prefix_table {
 		const suffix_array &parent;
-		sparse_table<int, fn::minimum<>> st;
+		block_sparse_table<int, fn::minimum<>> st;
 
 	  public:
 		longest_common_prefix_table(const suffix_array &parent)
@@ -157,3 +157,12 @@ TEST_CASE("suffix array applications", "[string]") {
 	REQUIRE(lcp_table.substr_cmp(1, 4, 0, 3) > 0);
 	REQUIRE(lcp_table.substr_cmp(1, 2, 4, 2) == 0);
 }
+
+TEST_CASE("suffix array of an empty string", "[string]") {
+	std::string s;
+	suffix_array sa(s);
+	REQUIRE(sa.empty());
+	REQUIRE(sa.count_unique_substrings() == 0);
+	auto lcp_table = sa.longest_common_prefix();
+	REQUIRE(lcp_table.query(0, 0) == 0);
+}
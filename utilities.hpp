@@ -158,16 +158,21 @@ template <class T> struct magic_vector {
 	magic_vector(magic_vector &&other) = default;
 	magic_vector &operator=(magic_vector &&other) = default;
 
-	magic_vector &&operator+(size_t x) {
+	// results are returned by value, so that x = x + y never assigns x to
+	// itself
+	magic_vector operator+(size_t x) {
 		ptr->push_back(x);
 		return std::move(*this);
 	}
-	magic_vector &&operator+(magic_vector &&other) {
+	// small-to-large: the smaller vector is moved into the larger one
+	magic_vector operator+(magic_vector &&other) {
 		if (size() < other.size()) {
 			ptr.swap(other.ptr);
 		}
-		std::copy(other.ptr->begin(), other.ptr->end(),
+		std::move(other.ptr->begin(), other.ptr->end(),
 		          std::back_inserter(*ptr));
+		other.ptr->clear();
+		return std::move(*this);
 	}
 	std::vector<T> &operator*() { return *this; }
 